@@ -0,0 +1,149 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+
+namespace alloc {
+
+	/*
+	  n single-object blocks in one call. Allocators may provide
+		void allocate_batch(std::size_t n, T **out);
+		void deallocate_batch(T **p, std::size_t n);
+	  and the others are called once per block.
+	*/
+	template<typename Alloc, typename T>
+	auto aux_allocate_batch(Alloc& a, std::size_t n, T **out, int)
+		-> decltype(a.allocate_batch(n, out), void())
+	{
+		a.allocate_batch(n, out);
+	}
+
+	template<typename Alloc, typename T>
+	void aux_allocate_batch(Alloc& a, std::size_t n, T **out, long)
+	{
+		std::size_t i = 0;
+		try {
+			for (; i < n; ++i) {
+				out[i] = a.allocate(1);
+			}
+		}
+		catch (...) {
+			while (i > 0) {
+				a.deallocate(out[--i], 1);
+			}
+			throw;
+		}
+	}
+
+	template<typename Alloc, typename T>
+	void allocate_batch(Alloc& a, std::size_t n, T **out)
+	{
+		aux_allocate_batch(a, n, out, 0);
+	}
+
+
+	template<typename Alloc, typename T>
+	auto aux_deallocate_batch(Alloc& a, T **p, std::size_t n, int) noexcept
+		-> decltype(a.deallocate_batch(p, n), void())
+	{
+		a.deallocate_batch(p, n);
+	}
+
+	template<typename Alloc, typename T>
+	void aux_deallocate_batch(Alloc& a, T **p, std::size_t n, long) noexcept
+	{
+		for (std::size_t i = 0; i < n; ++i) {
+			a.deallocate(p[i], 1);
+		}
+	}
+
+	template<typename Alloc, typename T>
+	void deallocate_batch(Alloc& a, T **p, std::size_t n) noexcept
+	{
+		aux_deallocate_batch(a, p, n, 0);
+	}
+
+
+
+	//hands out the nodes of a known count, BatchSize at a time
+	template<typename Alloc, std::size_t BatchSize = 64>
+	class node_batch
+	{
+	public:
+		using pointer = typename std::allocator_traits<Alloc>::value_type *;
+
+	private:
+		Alloc& a;
+		pointer nodes[BatchSize];
+		std::size_t next = 0;   //nodes[next, num) are not handed out yet,
+		std::size_t num = 0;    //in ascending order so the run stays in address order
+		std::size_t want;   //nodes still expected by the caller
+
+	public:
+		node_batch(Alloc& a, std::size_t want) noexcept: a(a), want(want) {}
+		node_batch(const node_batch&) = delete;
+		node_batch& operator=(const node_batch&) = delete;
+
+		//nodes not handed out go back to the allocator
+		~node_batch() { deallocate_batch(a, nodes + next, num - next); }
+
+		pointer get()
+		{
+			if (next == num) {
+				std::size_t n = want < BatchSize ? want : BatchSize;
+				if (n == 0) {
+					n = 1;
+				}
+				allocate_batch(a, n, nodes);
+				next = 0;
+				num = n;
+			}
+
+			if (want > 0) {
+				--want;
+			}
+			return nodes[next++];
+		}
+
+		//gives back the node last taken by get() that ended up unused
+		void unget(pointer p) noexcept
+		{
+			nodes[--next] = p;
+			++want;
+		}
+	};
+
+
+	//collects freed nodes and returns them BatchSize at a time
+	template<typename Alloc, std::size_t BatchSize = 64>
+	class node_release
+	{
+	public:
+		using pointer = typename std::allocator_traits<Alloc>::value_type *;
+
+	private:
+		Alloc& a;
+		pointer nodes[BatchSize];
+		std::size_t num = 0;
+
+	public:
+		explicit node_release(Alloc& a) noexcept: a(a) {}
+		node_release(const node_release&) = delete;
+		node_release& operator=(const node_release&) = delete;
+
+		~node_release() { flush(); }
+
+		void put(pointer p) noexcept
+		{
+			if (num == BatchSize) {
+				flush();
+			}
+			nodes[num++] = p;
+		}
+
+		void flush() noexcept
+		{
+			deallocate_batch(a, nodes, num);
+			num = 0;
+		}
+	};
+}
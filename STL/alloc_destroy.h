@@ -1,18 +1,84 @@
 #pragma once
 #include <type_traits>
+#include <iterator>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <utility>
 
 namespace alloc {
 
-	template<typename T1, typename T2>
-	void construct(T1* p, const T2& value)
+	/*
+	  a type is trivially relocatable when moving an object to new storage
+	  and destroying the old one is the same as copying its bytes. That
+	  holds for every trivially copyable type; specialize for others, e.g.
+		template<> struct alloc::is_trivially_relocatable<order> : std::true_type {};
+	*/
+	template<typename T>
+	struct is_trivially_relocatable: std::is_trivially_copyable<T> {};
+
+	//types whose value-initialized state is all bits 0
+	template<typename T>
+	struct is_zero_initializable: std::integral_constant<bool,
+		std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+		std::is_pointer<T>::value> {};
+
+
+	/*
+	  Alloc can resize a block of old_num elements in place of allocate +
+	  copy + deallocate by reallocate(p, old_num, num), e.g. malloc_allocator
+	  and mremap_allocator. The bytes of the elements are moved with it.
+	*/
+	template<typename Alloc, typename = void>
+	struct has_reallocate: std::false_type {};
+
+	template<typename Alloc>
+	struct has_reallocate<Alloc, decltype(void(std::declval<Alloc&>().reallocate(
+		std::declval<typename Alloc::value_type*>(), std::size_t(), std::size_t())))>:
+		std::true_type {};
+
+
+	template<typename Iterator>
+	using iter_value_t = typename std::iterator_traits<Iterator>::value_type;
+
+	//both iterators are pointers to one type satisfying Trait
+	template<template<typename> class Trait, typename InputIterator,
+			 typename OutputIterator>
+	struct is_bitwise: std::integral_constant<bool,
+		std::is_pointer<InputIterator>::value &&
+		std::is_pointer<OutputIterator>::value &&
+		std::is_same<typename std::remove_const<iter_value_t<InputIterator>>::type,
+					 iter_value_t<OutputIterator>>::value &&
+		Trait<iter_value_t<OutputIterator>>::value> {};
+
+	template<typename InputIterator, typename OutputIterator>
+	using is_bitwise_copyable =
+		is_bitwise<std::is_trivially_copyable, InputIterator, OutputIterator>;
+
+	template<typename InputIterator, typename OutputIterator>
+	using is_bitwise_relocatable =
+		is_bitwise<is_trivially_relocatable, InputIterator, OutputIterator>;
+
+
+	//memmove of [first, last) to dest, which may overlap
+	template<typename T>
+	T *move_bytes(const T *first, const T *last, T *dest) noexcept
 	{
-		new (p) T1(value);
+		std::size_t n = last - first;
+		if (n != 0) {
+			std::memmove(static_cast<void*>(dest), static_cast<const void*>(first),
+						 n * sizeof(T));
+		}
+		return dest + n;
 	}
 
-	template<typename T1, typename T2>
-	void construct(T1 *p, T2&& value)
+
+
+	template<typename T1, typename... Args>
+	void construct(T1 *p, Args&&... args)
 	{
-		new (p) T1(std::forward<T2>(value));
+		new (p) T1(std::forward<Args>(args)...);
 	}
 
 	template<typename T>
@@ -29,11 +95,11 @@ namespace alloc {
 
 
 	template<typename ForwardIterator>
-	void aux_destroy(ForwardIterator begin, ForwardIterator end, 
+	void aux_destroy(ForwardIterator begin, ForwardIterator end,
 					 std::false_type) noexcept
 	{
 		for (; begin != end; ++begin) {
-			destroy(&*begin);
+			alloc::destroy(&*begin);
 		}
 	}
 
@@ -41,8 +107,305 @@ namespace alloc {
 	template<typename ForwardIterator>
 	void destroy(ForwardIterator begin, ForwardIterator end) noexcept
 	{
-		aux_destroy(begin, end, std::is_trivially_destructible<decltype(*begin)>());
+		aux_destroy(begin, end,
+			std::is_trivially_destructible<iter_value_t<ForwardIterator>>());
+	}
+
+
+
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator aux_uninitialized_copy(InputIterator first, InputIterator last,
+										   ForwardIterator dest, std::true_type) noexcept
+	{
+		return move_bytes(first, last, dest);
+	}
+
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator aux_uninitialized_copy(InputIterator first, InputIterator last,
+										   ForwardIterator dest, std::false_type)
+	{
+		return std::uninitialized_copy(first, last, dest);
+	}
+
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator uninitialized_copy(InputIterator first, InputIterator last,
+									   ForwardIterator dest)
+	{
+		return aux_uninitialized_copy(first, last, dest,
+			is_bitwise_copyable<InputIterator, ForwardIterator>());
+	}
+
+
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator aux_uninitialized_move(InputIterator first, InputIterator last,
+										   ForwardIterator dest, std::true_type) noexcept
+	{
+		return move_bytes(first, last, dest);
+	}
+
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator aux_uninitialized_move(InputIterator first, InputIterator last,
+										   ForwardIterator dest, std::false_type)
+	{
+		return std::uninitialized_move(first, last, dest);
+	}
+
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator uninitialized_move(InputIterator first, InputIterator last,
+									   ForwardIterator dest)
+	{
+		return aux_uninitialized_move(first, last, dest,
+			is_bitwise_copyable<InputIterator, ForwardIterator>());
+	}
+
+
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator aux_uninitialized_move_if_noexcept(InputIterator first, InputIterator last,
+													   ForwardIterator dest, std::true_type)
+	{
+		return alloc::uninitialized_move(first, last, dest);
+	}
+
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator aux_uninitialized_move_if_noexcept(InputIterator first, InputIterator last,
+													   ForwardIterator dest, std::false_type)
+	{
+		return alloc::uninitialized_copy(first, last, dest);
+	}
+
+	//moves when that cannot throw or the elements cannot be copied, copies otherwise
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator uninitialized_move_if_noexcept(InputIterator first, InputIterator last,
+												   ForwardIterator dest)
+	{
+		using T = typename std::iterator_traits<InputIterator>::value_type;
+		return aux_uninitialized_move_if_noexcept(first, last, dest,
+			std::integral_constant<bool, std::is_nothrow_move_constructible<T>::value ||
+										 !std::is_copy_constructible<T>::value>());
+	}
+
+
+	/*
+	  moves [first, last) to the uninitialized dest and destroys the source,
+	  the source storage is uninitialized afterwards. If it throws, dest
+	  holds no objects and the source is left as it was, unless a move-only
+	  element throws on move
+	*/
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator aux_uninitialized_relocate(InputIterator first, InputIterator last,
+											   ForwardIterator dest, std::true_type) noexcept
+	{
+		return move_bytes(first, last, dest);
+	}
+
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator aux_uninitialized_relocate(InputIterator first, InputIterator last,
+											   ForwardIterator dest, std::false_type)
+	{
+		ForwardIterator result = uninitialized_move_if_noexcept(first, last, dest);
+		alloc::destroy(first, last);
+		return result;
+	}
+
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator uninitialized_relocate(InputIterator first, InputIterator last,
+										   ForwardIterator dest)
+	{
+		return aux_uninitialized_relocate(first, last, dest,
+			is_bitwise_relocatable<InputIterator, ForwardIterator>());
+	}
+
+
+	/*
+	  uninitialized_relocate of [first, last) to dest that leaves n slots
+	  free where pos goes, returns the end of the relocated elements.
+	  Nothing is destroyed until both parts are in place
+	*/
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator aux_uninitialized_relocate_gap(InputIterator first, InputIterator pos,
+												   InputIterator last, ForwardIterator dest,
+												   std::size_t n, std::true_type) noexcept
+	{
+		ForwardIterator mid = move_bytes(first, pos, dest);
+		return move_bytes(pos, last, mid + n);
+	}
+
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator aux_uninitialized_relocate_gap(InputIterator first, InputIterator pos,
+												   InputIterator last, ForwardIterator dest,
+												   std::size_t n, std::false_type)
+	{
+		ForwardIterator mid = uninitialized_move_if_noexcept(first, pos, dest);
+		ForwardIterator result;
+		try {
+			result = uninitialized_move_if_noexcept(pos, last, mid + n);
+		}
+		catch (...) {
+			alloc::destroy(dest, mid);
+			throw;
+		}
+		alloc::destroy(first, last);
+		return result;
+	}
+
+	template<typename InputIterator, typename ForwardIterator>
+	ForwardIterator uninitialized_relocate_gap(InputIterator first, InputIterator pos,
+											   InputIterator last, ForwardIterator dest,
+											   std::size_t n)
+	{
+		return aux_uninitialized_relocate_gap(first, pos, last, dest, n,
+			is_bitwise_relocatable<InputIterator, ForwardIterator>());
+	}
+
+
+	template<typename ForwardIterator, typename T>
+	ForwardIterator aux_uninitialized_fill_n(ForwardIterator first, std::size_t n,
+											 const T& value, std::true_type) noexcept
+	{
+		unsigned char byte;
+		std::memcpy(&byte, &value, 1);
+		std::memset(static_cast<void*>(first), byte, n);
+		return first + n;
+	}
+
+	template<typename ForwardIterator, typename T>
+	ForwardIterator aux_uninitialized_fill_n(ForwardIterator first, std::size_t n,
+											 const T& value, std::false_type)
+	{
+		return std::uninitialized_fill_n(first, n, value);
+	}
+
+	//byte sized trivial values are filled by memset
+	template<typename ForwardIterator, typename T>
+	ForwardIterator uninitialized_fill_n(ForwardIterator first, std::size_t n,
+										 const T& value)
+	{
+		using value_type = iter_value_t<ForwardIterator>;
+		return aux_uninitialized_fill_n(first, n, value,
+			std::integral_constant<bool, std::is_pointer<ForwardIterator>::value &&
+				std::is_same<T, value_type>::value && sizeof(T) == 1 &&
+				std::is_trivially_copyable<T>::value>());
 	}
-}
 
 
+	template<typename ForwardIterator>
+	ForwardIterator aux_uninitialized_value_construct_n(ForwardIterator first,
+		std::size_t n, std::true_type) noexcept
+	{
+		if (n != 0) {
+			std::memset(static_cast<void*>(first), 0, n * sizeof(*first));
+		}
+		return first + n;
+	}
+
+	template<typename ForwardIterator>
+	ForwardIterator aux_uninitialized_value_construct_n(ForwardIterator first,
+		std::size_t n, std::false_type)
+	{
+		return std::uninitialized_value_construct_n(first, n);
+	}
+
+	template<typename ForwardIterator>
+	ForwardIterator aux_uninitialized_default_construct_n(ForwardIterator first,
+		std::size_t n, std::true_type) noexcept
+	{
+		return first + n;
+	}
+
+	template<typename ForwardIterator>
+	ForwardIterator aux_uninitialized_default_construct_n(ForwardIterator first,
+		std::size_t n, std::false_type)
+	{
+		return std::uninitialized_default_construct_n(first, n);
+	}
+
+	//n default-initialized objects, trivial types are left as they are
+	template<typename ForwardIterator>
+	ForwardIterator uninitialized_default_construct_n(ForwardIterator first, std::size_t n)
+	{
+		return aux_uninitialized_default_construct_n(first, n,
+			std::integral_constant<bool, std::is_pointer<ForwardIterator>::value &&
+				std::is_trivially_default_constructible<iter_value_t<ForwardIterator>>::value>());
+	}
+
+
+	//n value-initialized objects, zeroed by memset where that is the same
+	template<typename ForwardIterator>
+	ForwardIterator uninitialized_value_construct_n(ForwardIterator first, std::size_t n)
+	{
+		return aux_uninitialized_value_construct_n(first, n,
+			std::integral_constant<bool, std::is_pointer<ForwardIterator>::value &&
+				is_zero_initializable<iter_value_t<ForwardIterator>>::value>());
+	}
+
+
+
+	//assignments between constructed objects
+	template<typename InputIterator, typename OutputIterator>
+	OutputIterator aux_move(InputIterator first, InputIterator last,
+							OutputIterator dest, std::true_type) noexcept
+	{
+		return move_bytes(first, last, dest);
+	}
+
+	template<typename InputIterator, typename OutputIterator>
+	OutputIterator aux_move(InputIterator first, InputIterator last,
+							OutputIterator dest, std::false_type)
+	{
+		return std::move(first, last, dest);
+	}
+
+	template<typename InputIterator, typename OutputIterator>
+	OutputIterator move(InputIterator first, InputIterator last, OutputIterator dest)
+	{
+		return aux_move(first, last, dest,
+			is_bitwise_copyable<InputIterator, OutputIterator>());
+	}
+
+
+	template<typename InputIterator, typename OutputIterator>
+	OutputIterator aux_copy(InputIterator first, InputIterator last,
+							OutputIterator dest, std::true_type) noexcept
+	{
+		return move_bytes(first, last, dest);
+	}
+
+	template<typename InputIterator, typename OutputIterator>
+	OutputIterator aux_copy(InputIterator first, InputIterator last,
+							OutputIterator dest, std::false_type)
+	{
+		return std::copy(first, last, dest);
+	}
+
+	template<typename InputIterator, typename OutputIterator>
+	OutputIterator copy(InputIterator first, InputIterator last, OutputIterator dest)
+	{
+		return aux_copy(first, last, dest,
+			is_bitwise_copyable<InputIterator, OutputIterator>());
+	}
+
+
+	template<typename BidirectionalIterator1, typename BidirectionalIterator2>
+	BidirectionalIterator2 aux_move_backward(BidirectionalIterator1 first,
+		BidirectionalIterator1 last, BidirectionalIterator2 dest_last, std::true_type) noexcept
+	{
+		BidirectionalIterator2 dest = dest_last - (last - first);
+		move_bytes(first, last, dest);
+		return dest;
+	}
+
+	template<typename BidirectionalIterator1, typename BidirectionalIterator2>
+	BidirectionalIterator2 aux_move_backward(BidirectionalIterator1 first,
+		BidirectionalIterator1 last, BidirectionalIterator2 dest_last, std::false_type)
+	{
+		return std::move_backward(first, last, dest_last);
+	}
+
+	template<typename BidirectionalIterator1, typename BidirectionalIterator2>
+	BidirectionalIterator2 move_backward(BidirectionalIterator1 first,
+		BidirectionalIterator1 last, BidirectionalIterator2 dest_last)
+	{
+		return aux_move_backward(first, last, dest_last,
+			is_bitwise_copyable<BidirectionalIterator1, BidirectionalIterator2>());
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <cstddef>
+#include <atomic>
+#include <vector>
+#include <ostream>
+
+
+/*
+  counters of the pooled allocators. They are compiled in only when
+  CX_ALLOC_STATS is defined, otherwise every counter is an empty object
+  and reads 0; the byte totals of a snapshot are always filled in.
+*/
+namespace alloc_stats {
+
+#ifdef CX_ALLOC_STATS
+	constexpr bool enabled = true;
+
+	//written by one thread at a time, read by any
+	class local_counter
+	{
+	private:
+		std::atomic<std::size_t> value{ 0 };
+
+	public:
+		void add(std::size_t n = 1) noexcept {
+			value.store(value.load(std::memory_order_relaxed) + n,
+						std::memory_order_relaxed);
+		}
+		void sub(std::size_t n = 1) noexcept {
+			value.store(value.load(std::memory_order_relaxed) - n,
+						std::memory_order_relaxed);
+		}
+		std::size_t get() const noexcept {
+			return value.load(std::memory_order_relaxed);
+		}
+	};
+
+	//written by any thread
+	class shared_counter
+	{
+	private:
+		std::atomic<std::size_t> value{ 0 };
+
+	public:
+		void add(std::size_t n = 1) noexcept {
+			value.fetch_add(n, std::memory_order_relaxed);
+		}
+		void sub(std::size_t n = 1) noexcept {
+			value.fetch_sub(n, std::memory_order_relaxed);
+		}
+		std::size_t get() const noexcept {
+			return value.load(std::memory_order_relaxed);
+		}
+	};
+#else
+	constexpr bool enabled = false;
+
+	class local_counter
+	{
+	public:
+		void add(std::size_t = 1) noexcept {}
+		void sub(std::size_t = 1) noexcept {}
+		std::size_t get() const noexcept { return 0; }
+	};
+
+	using shared_counter = local_counter;
+#endif
+
+
+	//calls of the oom handler of every malloc_allocator
+	inline shared_counter& oom_calls() noexcept
+	{
+		static shared_counter counter;
+		return counter;
+	}
+}
+
+
+
+struct size_class_stats
+{
+	std::size_t size = 0;           //block size of the class
+	std::size_t allocate = 0;
+	std::size_t deallocate = 0;     //counted when the owner thread takes the block back
+	std::size_t refill = 0;
+	std::size_t chunk_alloc = 0;
+	std::size_t chunks = 0;         //chunks currently carved into this class
+	std::size_t used_blocks = 0;    //blocks handed out
+	std::size_t free_blocks = 0;    //blocks of the chunks not handed out
+};
+
+
+//snapshot of one allocator, see free_list_allocator::stats()
+struct allocator_stats
+{
+	bool counters_enabled = alloc_stats::enabled;
+	std::size_t heap_bytes = 0;     //ever requested from the chunk source
+	std::size_t reserved_bytes = 0; //held in chunks now
+	std::size_t used_bytes = 0;     //handed out from the chunks
+	std::size_t chunks = 0;
+	std::size_t large_allocate = 0; //blocks too large to pool
+	std::size_t large_deallocate = 0;
+	std::size_t large_bytes = 0;
+	std::size_t oom_calls = 0;
+	std::vector<size_class_stats> classes;
+
+	//share of the reserved bytes not in use
+	double fragmentation() const noexcept
+	{
+		if (reserved_bytes == 0) {
+			return 0.0;
+		}
+		return 1.0 - static_cast<double>(used_bytes) / reserved_bytes;
+	}
+
+	void write_json(std::ostream& os) const;
+};
+
+
+inline void allocator_stats::write_json(std::ostream& os) const
+{
+	os << "{\"counters_enabled\":" << (counters_enabled ? "true" : "false")
+	   << ",\"heap_bytes\":" << heap_bytes
+	   << ",\"reserved_bytes\":" << reserved_bytes
+	   << ",\"used_bytes\":" << used_bytes
+	   << ",\"fragmentation\":" << fragmentation()
+	   << ",\"chunks\":" << chunks
+	   << ",\"large\":{\"allocate\":" << large_allocate
+	   << ",\"deallocate\":" << large_deallocate
+	   << ",\"bytes\":" << large_bytes << '}'
+	   << ",\"oom_calls\":" << oom_calls
+	   << ",\"classes\":[";
+
+	for (std::size_t i = 0; i < classes.size(); ++i)
+	{
+		const size_class_stats& c = classes[i];
+		if (i > 0) {
+			os << ',';
+		}
+		os << "{\"size\":" << c.size
+		   << ",\"allocate\":" << c.allocate
+		   << ",\"deallocate\":" << c.deallocate
+		   << ",\"refill\":" << c.refill
+		   << ",\"chunk_alloc\":" << c.chunk_alloc
+		   << ",\"chunks\":" << c.chunks
+		   << ",\"used_blocks\":" << c.used_blocks
+		   << ",\"free_blocks\":" << c.free_blocks << '}';
+	}
+
+	os << "]}";
+}
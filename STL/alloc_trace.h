@@ -0,0 +1,418 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+
+/*
+  allocation traces. With CX_ALLOC_TRACE defined, free_list_allocator and
+  slab_allocator report every allocate/deallocate, and between
+	alloc_trace::start("run.trace");
+	alloc_trace::stop();
+  the calls are written to a binary file: a trace_file_header followed by
+  trace_events, each thread's events in order. load_trace() reads a file
+  back and replay_trace() drives an allocator through it.
+*/
+struct trace_event
+{
+	enum : std::uint32_t { ALLOCATE = 0, DEALLOCATE = 1 };
+
+	std::uint64_t time;     //ns since start()
+	std::uint64_t ptr;      //address when recorded, pairs a deallocate with its allocate
+	std::uint64_t size;     //bytes
+	std::uint32_t thread;   //numbered in the order threads first record
+	std::uint32_t op;
+};
+
+
+struct trace_file_header
+{
+	char magic[8];          //"CXTRACE"
+	std::uint32_t version;
+	std::uint32_t event_size;
+};
+
+
+namespace alloc_trace {
+
+#ifdef CX_ALLOC_TRACE
+	constexpr bool enabled = true;
+#else
+	constexpr bool enabled = false;
+#endif
+
+	constexpr char MAGIC[8] = "CXTRACE";
+	constexpr std::uint32_t VERSION = 1;
+
+
+	class recorder
+	{
+	private:
+		static constexpr std::size_t BUFFER_SIZE = 1024;
+
+		//events of one thread, written to the file when full
+		struct thread_buffer
+		{
+			std::mutex mutex;
+			trace_event events[BUFFER_SIZE];
+			std::size_t num = 0;
+			std::uint32_t id;
+
+			explicit thread_buffer(std::uint32_t id) noexcept: id(id) {}
+			~thread_buffer();
+		};
+
+		std::mutex file_mutex;      //guards file and buffers
+		std::FILE *file = nullptr;
+		std::vector<thread_buffer*> buffers;
+		std::uint32_t next_thread = 0;
+		std::chrono::steady_clock::time_point start_time;
+		std::atomic<bool> active{ false };
+
+		recorder() {}
+		~recorder() { stop(); }
+
+		thread_buffer& local_buffer();
+		void write(thread_buffer& buffer) noexcept;
+
+	public:
+		static recorder& instance()
+		{
+			static recorder r;
+			return r;
+		}
+
+		bool start(const char *path);
+		void stop() noexcept;
+		bool recording() const noexcept { return active.load(std::memory_order_relaxed); }
+
+		void record(std::uint32_t op, const void *p, std::size_t byte) noexcept;
+	};
+
+
+	inline recorder::thread_buffer& recorder::local_buffer()
+	{
+		static thread_local thread_buffer *buffer = nullptr;
+		static thread_local struct holder
+		{
+			thread_buffer *&buffer;
+			~holder() { delete buffer; }
+		} owner{ buffer };
+
+		if (buffer == nullptr) {
+			std::lock_guard<std::mutex> lock(file_mutex);
+			buffer = new thread_buffer(next_thread++);
+			buffers.push_back(buffer);
+		}
+		return *buffer;
+	}
+
+
+	inline recorder::thread_buffer::~thread_buffer()
+	{
+		recorder& r = instance();
+		std::lock_guard<std::mutex> lock(r.file_mutex);
+		{
+			std::lock_guard<std::mutex> buffer_lock(mutex);
+			r.write(*this);
+		}
+		r.buffers.erase(std::find(r.buffers.begin(), r.buffers.end(), this));
+	}
+
+
+	//called with file_mutex and the buffer's mutex held
+	inline void recorder::write(thread_buffer& buffer) noexcept
+	{
+		if (file != nullptr && buffer.num > 0) {
+			std::fwrite(buffer.events, sizeof(trace_event), buffer.num, file);
+		}
+		buffer.num = 0;
+	}
+
+
+	inline bool recorder::start(const char *path)
+	{
+		std::lock_guard<std::mutex> lock(file_mutex);
+		if (file != nullptr) {
+			return false;
+		}
+
+		file = std::fopen(path, "wb");
+		if (file == nullptr) {
+			return false;
+		}
+
+		trace_file_header header = {};
+		std::copy(MAGIC, MAGIC + sizeof(MAGIC), header.magic);
+		header.version = VERSION;
+		header.event_size = sizeof(trace_event);
+		std::fwrite(&header, sizeof(header), 1, file);
+
+		//events left from an earlier trace are dropped
+		for (thread_buffer *buffer : buffers) {
+			std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+			buffer->num = 0;
+		}
+
+		start_time = std::chrono::steady_clock::now();
+		active.store(true, std::memory_order_release);
+		return true;
+	}
+
+
+	inline void recorder::stop() noexcept
+	{
+		active.store(false, std::memory_order_relaxed);
+
+		std::lock_guard<std::mutex> lock(file_mutex);
+		if (file == nullptr) {
+			return;
+		}
+
+		for (thread_buffer *buffer : buffers) {
+			std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+			write(*buffer);
+		}
+
+		std::fclose(file);
+		file = nullptr;
+	}
+
+
+	inline void recorder::record(std::uint32_t op, const void *p,
+								 std::size_t byte) noexcept
+	{
+		if (!active.load(std::memory_order_acquire)) {
+			return;
+		}
+
+		thread_buffer *buffer;
+		try {
+			buffer = &local_buffer();
+		}
+		catch (...) {
+			return;
+		}
+
+		std::unique_lock<std::mutex> buffer_lock(buffer->mutex);
+		trace_event& e = buffer->events[buffer->num++];
+		e.time = static_cast<std::uint64_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start_time).count());
+		e.ptr = reinterpret_cast<std::uintptr_t>(p);
+		e.size = byte;
+		e.thread = buffer->id;
+		e.op = op;
+
+		if (buffer->num == BUFFER_SIZE) {
+			//file_mutex is taken before a buffer's mutex
+			buffer_lock.unlock();
+			std::lock_guard<std::mutex> lock(file_mutex);
+			buffer_lock.lock();
+			if (buffer->num == BUFFER_SIZE) {
+				write(*buffer);
+			}
+		}
+	}
+
+
+	inline bool start(const char *path) { return recorder::instance().start(path); }
+	inline void stop() noexcept { recorder::instance().stop(); }
+
+
+	//hooks of the allocators, nothing unless CX_ALLOC_TRACE is defined
+	inline void on_allocate(const void *p, std::size_t byte) noexcept
+	{
+		if (enabled) {
+			recorder::instance().record(trace_event::ALLOCATE, p, byte);
+		}
+	}
+
+	inline void on_deallocate(const void *p, std::size_t byte) noexcept
+	{
+		if (enabled) {
+			recorder::instance().record(trace_event::DEALLOCATE, p, byte);
+		}
+	}
+
+
+	//resident set size of the process, 0 where unknown
+	inline std::size_t resident_bytes() noexcept
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+			return counters.WorkingSetSize;
+		}
+		return 0;
+#else
+		std::FILE *statm = std::fopen("/proc/self/statm", "r");
+		if (statm == nullptr) {
+			return 0;
+		}
+
+		unsigned long size = 0, resident = 0;
+		int n = std::fscanf(statm, "%lu %lu", &size, &resident);
+		std::fclose(statm);
+		return n == 2 ? resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#endif
+	}
+}
+
+
+
+//events of a trace file in time order
+inline std::vector<trace_event> load_trace(const char *path)
+{
+	std::FILE *file = std::fopen(path, "rb");
+	if (file == nullptr) {
+		throw std::runtime_error("cannot open trace file");
+	}
+
+	trace_file_header header;
+	if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+		!std::equal(header.magic, header.magic + sizeof(header.magic), alloc_trace::MAGIC) ||
+		header.version != alloc_trace::VERSION ||
+		header.event_size != sizeof(trace_event)) {
+		std::fclose(file);
+		throw std::runtime_error("not a trace file of this version");
+	}
+
+	std::vector<trace_event> events;
+	trace_event buffer[1024];
+	std::size_t n;
+	while ((n = std::fread(buffer, sizeof(trace_event), 1024, file)) > 0) {
+		events.insert(events.end(), buffer, buffer + n);
+	}
+	std::fclose(file);
+
+	//threads flush in blocks, interleave them again
+	std::stable_sort(events.begin(), events.end(),
+		[](const trace_event& lhs, const trace_event& rhs) { return lhs.time < rhs.time; });
+	return events;
+}
+
+
+
+struct replay_result
+{
+	std::size_t events = 0;
+	double seconds = 0.0;
+	std::size_t peak_live_bytes = 0;    //most bytes allocated at once
+	std::size_t peak_rss_bytes = 0;     //largest growth of the resident set
+
+	double ops_per_second() const noexcept {
+		return seconds > 0.0 ? events / seconds : 0.0;
+	}
+
+	//share of the resident growth not holding live blocks
+	double fragmentation() const noexcept
+	{
+		if (peak_rss_bytes == 0 || peak_live_bytes >= peak_rss_bytes) {
+			return 0.0;
+		}
+		return 1.0 - static_cast<double>(peak_live_bytes) / peak_rss_bytes;
+	}
+};
+
+
+/*
+  replays the events on one thread in time order, so blocks freed by
+  another thread when recorded are freed by the allocating thread here.
+  Alloc allocates bytes: malloc_allocator<char>, free_list_allocator<char>,
+  polymorphic_allocator<char>... Blocks still live at the end are freed
+  after the measurement.
+*/
+template<typename Alloc>
+replay_result replay_trace(const std::vector<trace_event>& events, Alloc& a)
+{
+	static_assert(sizeof(typename Alloc::value_type) == 1, "Alloc must allocate bytes");
+	using pointer = typename Alloc::value_type*;
+
+	struct block
+	{
+		pointer p;
+		std::size_t size;
+	};
+
+	//sampling the resident set costs a system call
+	constexpr std::size_t RSS_PERIOD = 4096;
+
+	replay_result result;
+	std::unordered_map<std::uint64_t, block> live;
+	live.reserve(1024);
+	std::size_t live_bytes = 0;
+	std::size_t base_rss = alloc_trace::resident_bytes();
+
+	auto sample_rss = [&]() {
+		std::size_t rss = alloc_trace::resident_bytes();
+		if (rss > base_rss && rss - base_rss > result.peak_rss_bytes) {
+			result.peak_rss_bytes = rss - base_rss;
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	for (const trace_event& e : events)
+	{
+		if (e.op == trace_event::ALLOCATE)
+		{
+			pointer p = a.allocate(e.size);
+			auto inserted = live.insert(std::make_pair(e.ptr, block{ p, e.size }));
+			if (!inserted.second) {
+				//the deallocate was not recorded
+				a.deallocate(inserted.first->second.p, inserted.first->second.size);
+				live_bytes -= inserted.first->second.size;
+				inserted.first->second = block{ p, e.size };
+			}
+
+			live_bytes += e.size;
+			if (live_bytes > result.peak_live_bytes) {
+				result.peak_live_bytes = live_bytes;
+			}
+		}
+		else
+		{
+			auto iter = live.find(e.ptr);
+			//allocated before the trace started
+			if (iter == live.end()) {
+				continue;
+			}
+
+			a.deallocate(iter->second.p, iter->second.size);
+			live_bytes -= iter->second.size;
+			live.erase(iter);
+		}
+
+		if (++result.events % RSS_PERIOD == 0) {
+			sample_rss();
+		}
+	}
+	sample_rss();
+	result.seconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start).count();
+
+	for (auto& entry : live) {
+		a.deallocate(entry.second.p, entry.second.size);
+	}
+	return result;
+}
@@ -0,0 +1,282 @@
+#pragma once
+#include "memory_resource.h"
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <new>
+#include <type_traits>
+
+
+/*
+  bump-pointer arena. Memory is handed out from a chain of blocks and is
+  never freed one allocation at a time; reset() rewinds to the first block
+  and keeps every block for reuse, release() gives the blocks back.
+  Objects living in the arena must be destroyed before reset()/release().
+  Blocks come from the upstream resource, malloc by default.
+  An arena is not thread safe, use one per request or per thread.
+*/
+class monotonic_arena
+{
+private:
+	struct block
+	{
+		block *next;
+		std::size_t size;   //including the header
+	};
+
+	block *first_block = nullptr;
+	block *current_block = nullptr;
+	char *start_pool = nullptr;
+	char *end_pool = nullptr;
+	std::size_t block_size;
+	memory_resource *upstream;
+
+	//initial buffer supplied by the user, never freed by the arena
+	char *buffer = nullptr;
+	std::size_t buffer_size = 0;
+
+	static thread_local monotonic_arena *current_arena;
+
+	static char *align_up(char *p, std::size_t align) noexcept
+	{
+		return reinterpret_cast<char*>(
+			(reinterpret_cast<std::uintptr_t>(p) + align - 1) & ~(align - 1));
+	}
+
+	static char *block_begin(block *b) noexcept
+	{
+		return reinterpret_cast<char*>(b) + sizeof(block);
+	}
+
+	void *grow(std::size_t byte, std::size_t align);
+
+public:
+	static constexpr std::size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+	explicit monotonic_arena(std::size_t block_size = DEFAULT_BLOCK_SIZE,
+							 memory_resource *upstream = malloc_memory_resource()):
+		block_size(block_size), upstream(upstream) {}
+
+	monotonic_arena(void *buffer, std::size_t size,
+					std::size_t block_size = DEFAULT_BLOCK_SIZE,
+					memory_resource *upstream = malloc_memory_resource()):
+		start_pool(static_cast<char*>(buffer)),
+		end_pool(static_cast<char*>(buffer) + size),
+		block_size(block_size), upstream(upstream),
+		buffer(static_cast<char*>(buffer)), buffer_size(size) {}
+
+	monotonic_arena(const monotonic_arena&) = delete;
+	monotonic_arena& operator=(const monotonic_arena&) = delete;
+
+	~monotonic_arena() noexcept { release(); }
+
+	void *allocate(std::size_t byte, std::size_t align)
+	{
+		char *result = align_up(start_pool, align);
+		if (start_pool != nullptr &&
+			result <= end_pool && byte <= std::size_t(end_pool - result)) {
+			start_pool = result + byte;
+			return result;
+		}
+
+		return grow(byte, align);
+	}
+
+	void reset() noexcept;
+	void release() noexcept;
+	memory_resource *upstream_resource() const noexcept { return upstream; }
+
+
+	/*
+	  makes an arena the current one of this thread while the scope lives,
+	  arena_allocator allocates from the current arena
+	*/
+	class scope
+	{
+	private:
+		monotonic_arena *prev;
+
+	public:
+		explicit scope(monotonic_arena& arena) noexcept: prev(current_arena) {
+			current_arena = &arena;
+		}
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+		~scope() noexcept { current_arena = prev; }
+	};
+
+	static monotonic_arena *current() noexcept { return current_arena; }
+};
+
+
+inline thread_local monotonic_arena *monotonic_arena::current_arena = nullptr;
+
+
+inline void *monotonic_arena::grow(std::size_t byte, std::size_t align)
+{
+	//blocks kept by reset() are reused before new ones are allocated
+	block *next = current_block != nullptr ? current_block->next : first_block;
+
+	while (next != nullptr)
+	{
+		char *result = align_up(block_begin(next), align);
+		if (result + byte <= reinterpret_cast<char*>(next) + next->size) {
+			current_block = next;
+			start_pool = result + byte;
+			end_pool = reinterpret_cast<char*>(next) + next->size;
+			return result;
+		}
+		next = next->next;
+	}
+
+	//blocks double in size, and always hold the request
+	std::size_t size = sizeof(block) + byte + align;
+	std::size_t grow_size = current_block != nullptr ?
+		current_block->size * 2 : block_size;
+	if (size < grow_size) {
+		size = grow_size;
+	}
+
+	block *new_block = static_cast<block*>(
+		upstream->allocate(size, memory_resource::MAX_ALIGN));
+	new_block->size = size;
+
+	//link after current_block so that the chain stays in allocation order
+	if (current_block != nullptr) {
+		new_block->next = current_block->next;
+		current_block->next = new_block;
+	}
+	else {
+		new_block->next = first_block;
+		first_block = new_block;
+	}
+
+	current_block = new_block;
+	char *result = align_up(block_begin(new_block), align);
+	start_pool = result + byte;
+	end_pool = reinterpret_cast<char*>(new_block) + size;
+	return result;
+}
+
+
+inline void monotonic_arena::reset() noexcept
+{
+	current_block = nullptr;
+	start_pool = buffer;
+	end_pool = buffer + buffer_size;
+}
+
+
+inline void monotonic_arena::release() noexcept
+{
+	while (first_block != nullptr)
+	{
+		block *next = first_block->next;
+		upstream->deallocate(first_block, first_block->size,
+							 memory_resource::MAX_ALIGN);
+		first_block = next;
+	}
+
+	reset();
+}
+
+
+//monotonic_arena as a memory_resource, for polymorphic_allocator
+class monotonic_buffer_resource: public memory_resource
+{
+private:
+	monotonic_arena arena;
+
+public:
+	explicit monotonic_buffer_resource(
+		std::size_t block_size = monotonic_arena::DEFAULT_BLOCK_SIZE,
+		memory_resource *upstream = malloc_memory_resource()):
+		arena(block_size, upstream) {}
+
+	monotonic_buffer_resource(void *buffer, std::size_t size,
+		std::size_t block_size = monotonic_arena::DEFAULT_BLOCK_SIZE,
+		memory_resource *upstream = malloc_memory_resource()):
+		arena(buffer, size, block_size, upstream) {}
+
+	void reset() noexcept { arena.reset(); }
+	void release() noexcept { arena.release(); }
+	memory_resource *upstream_resource() const noexcept {
+		return arena.upstream_resource();
+	}
+
+protected:
+	void *do_allocate(std::size_t byte, std::size_t align) override
+	{
+		return arena.allocate(byte, align);
+	}
+
+	void do_deallocate(void *, std::size_t, std::size_t) noexcept override {}
+
+	bool do_is_equal(const memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+
+/*
+  allocator over a monotonic_arena, deallocate is a no-op. A default
+  constructed allocator binds to the current arena of the calling thread,
+  containers that share an arena compare equal and may exchange storage. e.g.
+	monotonic_arena arena;
+	cx_list<int, arena_allocator<int>> list{arena_allocator<int>(arena)};
+  or
+	monotonic_arena::scope guard(arena);
+	cx_list<int, arena_allocator<int>> list;
+*/
+template<typename T>
+class arena_allocator
+{
+private:
+	template<typename U>
+	friend class arena_allocator;
+
+	monotonic_arena *arena;
+
+public:
+	typedef T value_type;
+
+	//storage never outlives its arena, so the arena travels with it
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+	using is_always_equal = std::false_type;
+
+	arena_allocator() noexcept: arena(monotonic_arena::current()) {}
+	explicit arena_allocator(monotonic_arena& arena) noexcept: arena(&arena) {}
+	template<typename U>
+	arena_allocator(const arena_allocator<U>& other) noexcept:
+		arena(other.arena) {}
+
+	T *allocate(std::size_t num)
+	{
+		assert(arena != nullptr && "no monotonic_arena::scope on this thread");
+		if (arena == nullptr) {
+			throw std::bad_alloc();
+		}
+
+		return static_cast<T*>(arena->allocate(num * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T *, std::size_t) noexcept {}
+
+	monotonic_arena *resource() const noexcept { return arena; }
+};
+
+
+template<typename T1, typename T2>
+bool operator==(const arena_allocator<T1>& lhs, const arena_allocator<T2>& rhs)
+{
+	return lhs.resource() == rhs.resource();
+}
+
+template<typename T1, typename T2>
+bool operator!=(const arena_allocator<T1>& lhs, const arena_allocator<T2>& rhs)
+{
+	return !(lhs == rhs);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//the 64-bit scan intrinsics exist only on 64-bit MSVC targets
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+#define CX_MSVC_BITSCAN64
+#endif
+
+namespace bits {
+
+	//index of the lowest set bit, x must not be 0
+	inline unsigned countr_zero(std::uint64_t x) noexcept
+	{
+#if defined(CX_MSVC_BITSCAN64)
+		unsigned long index;
+		_BitScanForward64(&index, x);
+		return index;
+#elif defined(_MSC_VER)
+		unsigned long index;
+		if (_BitScanForward(&index, static_cast<unsigned long>(x))) {
+			return index;
+		}
+		_BitScanForward(&index, static_cast<unsigned long>(x >> 32));
+		return index + 32;
+#else
+		return __builtin_ctzll(x);
+#endif
+	}
+
+	//index of the highest set bit, i.e. floor(log2(x)), x must not be 0
+	inline unsigned highest_bit(std::uint64_t x) noexcept
+	{
+#if defined(CX_MSVC_BITSCAN64)
+		unsigned long index;
+		_BitScanReverse64(&index, x);
+		return index;
+#elif defined(_MSC_VER)
+		unsigned long index;
+		if (_BitScanReverse(&index, static_cast<unsigned long>(x >> 32))) {
+			return index + 32;
+		}
+		_BitScanReverse(&index, static_cast<unsigned long>(x));
+		return index;
+#else
+		return 63 - __builtin_clzll(x);
+#endif
+	}
+
+	/*
+	  number of set bits. MSVC's __popcnt64 is the POPCNT instruction,
+	  which faults on CPUs without it, so it is only used when /arch:AVX
+	  or higher guarantees the CPU has it; otherwise the bits are summed
+	  in parallel within the word. GCC and Clang pick the instruction
+	  themselves with -mpopcnt or -march.
+	*/
+	inline unsigned popcount(std::uint64_t x) noexcept
+	{
+#if defined(_MSC_VER) && defined(_M_X64) && defined(__AVX__)
+		return unsigned(__popcnt64(x));
+#elif defined(_MSC_VER)
+		x = x - ((x >> 1) & 0x5555555555555555ull);
+		x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+		x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+		return unsigned((x * 0x0101010101010101ull) >> 56);
+#else
+		return __builtin_popcountll(x);
+#endif
+	}
+}
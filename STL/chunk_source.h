@@ -0,0 +1,213 @@
+#pragma once
+#include "malloc_allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+
+/*
+  where the pooled allocators get their chunks and their large blocks.
+  A chunk source is a class with
+	static constexpr std::size_t PAGE_BYTES;   //granularity it maps memory in
+	static void *allocate(std::size_t byte, std::size_t align);
+	static void deallocate(void *p, std::size_t byte, std::size_t align) noexcept;
+  and is passed to free_list_allocator or slab_allocator, e.g.
+	cx_deque<int, free_list_allocator<int, geometric_size_classes<>,
+			  huge_page_chunk_source>> big;
+  align is a power of 2, the same byte and align are passed to deallocate.
+*/
+struct malloc_chunk_source
+{
+	static constexpr std::size_t PAGE_BYTES = 4096;
+
+	//the aligned calls bypass the heap profiler, the blocks carved from a
+	//chunk are sampled by the allocator instead
+	static void *allocate(std::size_t byte, std::size_t align)
+	{
+		return malloc_allocator<char>::aligned_allocate(byte,
+			align < alignof(std::max_align_t) ? alignof(std::max_align_t) : align);
+	}
+
+	static void deallocate(void *p, std::size_t, std::size_t) noexcept
+	{
+		malloc_allocator<char>::aligned_deallocate(p);
+	}
+};
+
+
+
+enum class page_kind
+{
+	normal,             //4K pages
+	transparent_huge,   //2MB aligned mappings with MADV_HUGEPAGE
+	explicit_huge       //MAP_HUGETLB, transparent_huge if none are reserved
+};
+
+
+/*
+  maps memory straight from the system. Huge pages are only requested on
+  Linux, elsewhere every kind maps normal pages. Blocks smaller than
+  MAP_THRESHOLD are not worth a system call and go to malloc.
+*/
+template<page_kind Pages = page_kind::normal>
+class mmap_chunk_source
+{
+private:
+	static constexpr std::size_t SMALL_PAGE_SIZE = 4096;
+	static constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+	static constexpr bool HUGE_PAGES = Pages != page_kind::normal;
+
+public:
+	static constexpr std::size_t PAGE_BYTES = HUGE_PAGES ? HUGE_PAGE_SIZE : SMALL_PAGE_SIZE;
+	static constexpr std::size_t MAP_THRESHOLD = HUGE_PAGES ? HUGE_PAGE_SIZE : 64 * 1024;
+
+private:
+	static std::size_t round_up(std::size_t byte, std::size_t align) noexcept
+	{
+		return (byte + align - 1) & ~(align - 1);
+	}
+
+	static void *map(std::size_t byte, std::size_t align) noexcept;
+	static void unmap(void *p, std::size_t byte) noexcept;
+
+public:
+	static void *allocate(std::size_t byte, std::size_t align)
+	{
+		if (byte < MAP_THRESHOLD) {
+			return malloc_chunk_source::allocate(byte, align);
+		}
+
+		void *result = map(round_up(byte, PAGE_BYTES), align);
+		if (result == nullptr) {
+			throw std::bad_alloc();
+		}
+		return result;
+	}
+
+	static void deallocate(void *p, std::size_t byte, std::size_t align) noexcept
+	{
+		if (byte < MAP_THRESHOLD) {
+			malloc_chunk_source::deallocate(p, byte, align);
+			return;
+		}
+
+		unmap(p, round_up(byte, PAGE_BYTES));
+	}
+};
+
+
+#ifdef _WIN32
+
+template<page_kind Pages>
+void *mmap_chunk_source<Pages>::map(std::size_t byte, std::size_t align) noexcept
+{
+	//VirtualAlloc aligns to the allocation granularity, 64K
+	void *result = VirtualAlloc(nullptr, byte, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if (result == nullptr ||
+		reinterpret_cast<std::uintptr_t>(result) % align == 0) {
+		return result;
+	}
+	VirtualFree(result, 0, MEM_RELEASE);
+
+	//reserve more than needed to find an aligned address, then map exactly
+	//there; another thread may take the range in between, so retry
+	for (int i = 0; i < 8; ++i)
+	{
+		char *probe = static_cast<char*>(
+			VirtualAlloc(nullptr, byte + align, MEM_RESERVE, PAGE_NOACCESS));
+		if (probe == nullptr) {
+			return nullptr;
+		}
+		VirtualFree(probe, 0, MEM_RELEASE);
+
+		void *aligned = reinterpret_cast<void*>(
+			round_up(reinterpret_cast<std::uintptr_t>(probe), align));
+		result = VirtualAlloc(aligned, byte, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		if (result != nullptr) {
+			return result;
+		}
+	}
+
+	return nullptr;
+}
+
+
+template<page_kind Pages>
+void mmap_chunk_source<Pages>::unmap(void *p, std::size_t byte) noexcept
+{
+	VirtualFree(p, 0, MEM_RELEASE);
+}
+
+#else
+
+template<page_kind Pages>
+void *mmap_chunk_source<Pages>::map(std::size_t byte, std::size_t align) noexcept
+{
+	const int prot = PROT_READ | PROT_WRITE;
+	const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_HUGETLB
+	//huge pages come aligned to their size
+	if (Pages == page_kind::explicit_huge && align <= HUGE_PAGE_SIZE) {
+		void *result = mmap(nullptr, byte, prot, flags | MAP_HUGETLB, -1, 0);
+		if (result != MAP_FAILED) {
+			return result;
+		}
+	}
+#endif
+
+	//huge pages need 2MB aligned ranges, and so does a larger align
+	if (HUGE_PAGES && align < HUGE_PAGE_SIZE) {
+		align = HUGE_PAGE_SIZE;
+	}
+
+	std::size_t extra = align > SMALL_PAGE_SIZE ? align - SMALL_PAGE_SIZE : 0;
+	char *base = static_cast<char*>(mmap(nullptr, byte + extra, prot, flags, -1, 0));
+	if (base == MAP_FAILED) {
+		return nullptr;
+	}
+
+	//cut the unaligned head and the tail off the larger mapping
+	char *result = reinterpret_cast<char*>(
+		round_up(reinterpret_cast<std::uintptr_t>(base), align));
+	std::size_t head = result - base;
+	if (head > 0) {
+		munmap(base, head);
+	}
+	if (extra > head) {
+		munmap(result + byte, extra - head);
+	}
+
+#ifdef MADV_HUGEPAGE
+	//the kernel falls back to 4K pages when no huge page is free
+	if (HUGE_PAGES) {
+		madvise(result, byte, MADV_HUGEPAGE);
+	}
+#endif
+
+	return result;
+}
+
+
+template<page_kind Pages>
+void mmap_chunk_source<Pages>::unmap(void *p, std::size_t byte) noexcept
+{
+	munmap(p, byte);
+}
+
+#endif
+
+
+using huge_page_chunk_source = mmap_chunk_source<page_kind::transparent_huge>;
@@ -0,0 +1,501 @@
+#pragma once
+#include "bit_util.h"
+#include "cx_vector.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+
+
+/*
+  vector of bits packed into 64-bit words, e.g. as a permission mask
+	cx_bitvector granted(users), revoked(users);
+	granted.and_not(revoked);
+	for (auto i = granted.find_first(); i != cx_bitvector<>::npos; i = granted.find_next(i)) ...
+  count, find and the whole-vector operations work a word at a time, in
+  loops simple enough for the compiler to vectorize. The bits past size()
+  in the last word are always 0, so those loops need no masking.
+*/
+template<typename Alloc = free_list_allocator<std::uint64_t>>
+class cx_bitvector
+{
+public:
+	using word_type = std::uint64_t;
+	using value_type = bool;
+	using const_reference = bool;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using allocator_type = Alloc;
+
+	static constexpr size_type WORD_BITS = 64;
+	//returned by find_first and find_next when there is no set bit
+	static constexpr size_type npos = size_type(-1);
+
+	//stands for one bit of a word
+	class reference
+	{
+		friend class cx_bitvector;
+
+		word_type *word;
+		word_type mask;
+
+		reference(word_type *w, size_type bit) noexcept: word(w), mask(word_type(1) << bit) {}
+
+	public:
+		operator bool() const noexcept { return (*word & mask) != 0; }
+		bool operator~() const noexcept { return (*word & mask) == 0; }
+
+		reference& operator=(bool value) noexcept {
+			if (value)
+				*word |= mask;
+			else
+				*word &= ~mask;
+			return *this;
+		}
+		reference& operator=(const reference& bit) noexcept { return *this = bool(bit); }
+		reference& flip() noexcept { *word ^= mask; return *this; }
+
+		friend void swap(reference ls, reference rs) noexcept
+		{
+			bool tmp = ls;
+			ls = rs;
+			rs = tmp;
+		}
+	};
+
+	template<bool Const>
+	class basic_iterator;
+	using iterator = basic_iterator<false>;
+	using const_iterator = basic_iterator<true>;
+
+private:
+	cx_vector<word_type, Alloc> words;
+	size_type nbits;
+
+	static size_type words_for(size_type n) noexcept { return (n + WORD_BITS - 1) / WORD_BITS; }
+	//bits [bit, 64) of a word
+	static word_type mask_from(size_type bit) noexcept { return ~word_type(0) << bit; }
+	//bits [0, bit] of a word
+	static word_type mask_through(size_type bit) noexcept {
+		return ~word_type(0) >> (WORD_BITS - 1 - bit);
+	}
+
+	void clear_unused() noexcept {
+		if (nbits % WORD_BITS != 0) {
+			words[words.size() - 1] &= mask_through(nbits % WORD_BITS - 1);
+		}
+	}
+	size_type find_from_word(size_type w) const noexcept;
+
+public:
+	iterator begin() noexcept { return iterator(this, 0); }
+	iterator end() noexcept { return iterator(this, nbits); }
+	const_iterator begin() const noexcept { return const_iterator(this, 0); }
+	const_iterator end() const noexcept { return const_iterator(this, nbits); }
+	const_iterator cbegin() const noexcept { return begin(); }
+	const_iterator cend() const noexcept { return end(); }
+
+	size_type size() const noexcept { return nbits; }
+	size_type capacity() const noexcept { return words.capacity() * WORD_BITS; }
+	bool empty() const noexcept { return nbits == 0; }
+	reference operator[](size_type n) { return reference(&words[n / WORD_BITS], n % WORD_BITS); }
+	const_reference operator[](size_type n) const { return test(n); }
+
+	cx_bitvector() noexcept: words(), nbits(0) {}
+	explicit cx_bitvector(size_type n, bool value = false): words(words_for(n)), nbits(n) {
+		if (value) {
+			set();
+		}
+	}
+	cx_bitvector(std::initializer_list<bool> list);
+
+	void swap(cx_bitvector& vec) noexcept {
+		words.swap(vec.words);
+		std::swap(nbits, vec.nbits);
+	}
+	friend void swap(cx_bitvector& ls, cx_bitvector& rs) noexcept
+	{
+		ls.swap(rs);
+	}
+
+	reference front() { return (*this)[0]; }
+	const_reference front() const { return test(0); }
+	reference back() { return (*this)[nbits - 1]; }
+	const_reference back() const { return test(nbits - 1); }
+
+	void reserve(size_type n) { words.reserve(words_for(n)); }
+	void shrink_to_fit() { words.shrink_to_fit(); }
+	void resize(size_type n, bool value = false);
+	void push_back(bool value);
+	void pop_back();
+	void clear() noexcept {
+		words.clear();
+		nbits = 0;
+	}
+
+	bool test(size_type n) const noexcept {
+		return (words[n / WORD_BITS] >> (n % WORD_BITS)) & 1;
+	}
+	void set(size_type n) noexcept { words[n / WORD_BITS] |= word_type(1) << (n % WORD_BITS); }
+	void set(size_type n, bool value) noexcept { (*this)[n] = value; }
+	void reset(size_type n) noexcept { words[n / WORD_BITS] &= ~(word_type(1) << (n % WORD_BITS)); }
+	void flip(size_type n) noexcept { words[n / WORD_BITS] ^= word_type(1) << (n % WORD_BITS); }
+
+	//whole vector
+	void set() noexcept;
+	void reset() noexcept;
+	void flip() noexcept;
+	//bits [first, last)
+	void set_range(size_type first, size_type last) noexcept;
+	void reset_range(size_type first, size_type last) noexcept;
+
+	size_type count() const noexcept;
+	bool any() const noexcept;
+	bool none() const noexcept { return !any(); }
+	bool all() const noexcept { return count() == nbits; }
+	size_type find_first() const noexcept { return find_from_word(0); }
+	//first set bit after pos
+	size_type find_next(size_type pos) const noexcept;
+
+	//both vectors must have the same size
+	cx_bitvector& operator&=(const cx_bitvector& vec) noexcept;
+	cx_bitvector& operator|=(const cx_bitvector& vec) noexcept;
+	cx_bitvector& operator^=(const cx_bitvector& vec) noexcept;
+	//*this &= ~vec
+	cx_bitvector& and_not(const cx_bitvector& vec) noexcept;
+	cx_bitvector operator~() const {
+		cx_bitvector result(*this);
+		result.flip();
+		return result;
+	}
+
+	friend bool operator==(const cx_bitvector& lhs, const cx_bitvector& rhs)
+	{
+		return lhs.nbits == rhs.nbits && lhs.words == rhs.words;
+	}
+	friend bool operator!=(const cx_bitvector& lhs, const cx_bitvector& rhs)
+	{
+		return !(lhs == rhs);
+	}
+};
+
+
+template<typename Alloc>
+template<bool Const>
+class cx_bitvector<Alloc>::basic_iterator
+{
+	friend class cx_bitvector;
+
+public:
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = bool;
+	using reference = typename std::conditional<Const, bool,
+		typename cx_bitvector::reference>::type;
+	using pointer = void;
+	using difference_type = std::ptrdiff_t;
+
+private:
+	using vector_pointer = typename std::conditional<Const,
+		const cx_bitvector *, cx_bitvector *>::type;
+
+	vector_pointer vec;
+	size_type index;
+
+	basic_iterator(vector_pointer v, size_type n) noexcept: vec(v), index(n) {}
+
+public:
+	basic_iterator() noexcept: vec(nullptr), index(0) {}
+	//iterator converts to const_iterator
+	template<bool C, typename = typename std::enable_if<Const && !C>::type>
+	basic_iterator(const basic_iterator<C>& it) noexcept: vec(it.vec), index(it.index) {}
+
+	reference operator*() const { return (*vec)[index]; }
+	reference operator[](difference_type n) const { return (*vec)[index + n]; }
+
+	basic_iterator& operator++() noexcept { ++index; return *this; }
+	basic_iterator operator++(int) noexcept { basic_iterator tmp = *this; ++index; return tmp; }
+	basic_iterator& operator--() noexcept { --index; return *this; }
+	basic_iterator operator--(int) noexcept { basic_iterator tmp = *this; --index; return tmp; }
+	basic_iterator& operator+=(difference_type n) noexcept { index += n; return *this; }
+	basic_iterator& operator-=(difference_type n) noexcept { index -= n; return *this; }
+
+	basic_iterator operator+(difference_type n) const noexcept {
+		return basic_iterator(vec, index + n);
+	}
+	basic_iterator operator-(difference_type n) const noexcept {
+		return basic_iterator(vec, index - n);
+	}
+	difference_type operator-(const basic_iterator& it) const noexcept {
+		return difference_type(index - it.index);
+	}
+
+	bool operator==(const basic_iterator& it) const noexcept { return index == it.index; }
+	bool operator!=(const basic_iterator& it) const noexcept { return index != it.index; }
+	bool operator<(const basic_iterator& it) const noexcept { return index < it.index; }
+	bool operator>(const basic_iterator& it) const noexcept { return index > it.index; }
+	bool operator<=(const basic_iterator& it) const noexcept { return index <= it.index; }
+	bool operator>=(const basic_iterator& it) const noexcept { return index >= it.index; }
+
+	template<bool C>
+	friend class basic_iterator;
+};
+
+
+template<typename Alloc>
+constexpr std::size_t cx_bitvector<Alloc>::WORD_BITS;
+
+template<typename Alloc>
+constexpr std::size_t cx_bitvector<Alloc>::npos;
+
+
+template<typename Alloc>
+cx_bitvector<Alloc>::cx_bitvector(std::initializer_list<bool> list):
+	words(words_for(list.size())), nbits(list.size())
+{
+	size_type i = 0;
+	for (bool value : list) {
+		if (value) {
+			set(i);
+		}
+		++i;
+	}
+}
+
+
+template<typename Alloc>
+void cx_bitvector<Alloc>::resize(size_type n, bool value)
+{
+	size_type old_bits = nbits;
+	words.resize(words_for(n));
+	nbits = n;
+
+	if (n < old_bits) {
+		clear_unused();
+	}
+	else if (value) {
+		set_range(old_bits, n);
+	}
+}
+
+
+template<typename Alloc>
+void cx_bitvector<Alloc>::push_back(bool value)
+{
+	if (nbits % WORD_BITS == 0) {
+		words.push_back(0);
+	}
+	if (value) {
+		set(nbits);
+	}
+	++nbits;
+}
+
+
+template<typename Alloc>
+void cx_bitvector<Alloc>::pop_back()
+{
+	--nbits;
+	if (nbits % WORD_BITS == 0) {
+		words.pop_back();
+	}
+	else {
+		reset(nbits);
+	}
+}
+
+
+template<typename Alloc>
+void cx_bitvector<Alloc>::set() noexcept
+{
+	for (word_type& w : words) {
+		w = ~word_type(0);
+	}
+	clear_unused();
+}
+
+
+template<typename Alloc>
+void cx_bitvector<Alloc>::reset() noexcept
+{
+	for (word_type& w : words) {
+		w = 0;
+	}
+}
+
+
+template<typename Alloc>
+void cx_bitvector<Alloc>::flip() noexcept
+{
+	for (word_type& w : words) {
+		w = ~w;
+	}
+	clear_unused();
+}
+
+
+//partial words at the ends, whole words in between
+template<typename Alloc>
+void cx_bitvector<Alloc>::set_range(size_type first, size_type last) noexcept
+{
+	if (first >= last) {
+		return;
+	}
+
+	size_type first_word = first / WORD_BITS;
+	size_type last_word = (last - 1) / WORD_BITS;
+	word_type head = mask_from(first % WORD_BITS);
+	word_type tail = mask_through((last - 1) % WORD_BITS);
+	if (first_word == last_word) {
+		words[first_word] |= head & tail;
+		return;
+	}
+
+	words[first_word] |= head;
+	for (size_type w = first_word + 1; w < last_word; ++w) {
+		words[w] = ~word_type(0);
+	}
+	words[last_word] |= tail;
+}
+
+
+template<typename Alloc>
+void cx_bitvector<Alloc>::reset_range(size_type first, size_type last) noexcept
+{
+	if (first >= last) {
+		return;
+	}
+
+	size_type first_word = first / WORD_BITS;
+	size_type last_word = (last - 1) / WORD_BITS;
+	word_type head = mask_from(first % WORD_BITS);
+	word_type tail = mask_through((last - 1) % WORD_BITS);
+	if (first_word == last_word) {
+		words[first_word] &= ~(head & tail);
+		return;
+	}
+
+	words[first_word] &= ~head;
+	for (size_type w = first_word + 1; w < last_word; ++w) {
+		words[w] = 0;
+	}
+	words[last_word] &= ~tail;
+}
+
+
+template<typename Alloc>
+typename cx_bitvector<Alloc>::size_type cx_bitvector<Alloc>::count() const noexcept
+{
+	size_type result = 0;
+	for (size_type w = 0; w < words.size(); ++w) {
+		result += bits::popcount(words[w]);
+	}
+	return result;
+}
+
+
+template<typename Alloc>
+bool cx_bitvector<Alloc>::any() const noexcept
+{
+	for (size_type w = 0; w < words.size(); ++w) {
+		if (words[w] != 0)
+			return true;
+	}
+	return false;
+}
+
+
+template<typename Alloc>
+typename cx_bitvector<Alloc>::size_type
+cx_bitvector<Alloc>::find_from_word(size_type w) const noexcept
+{
+	for (; w < words.size(); ++w) {
+		if (words[w] != 0)
+			return w * WORD_BITS + bits::countr_zero(words[w]);
+	}
+	return npos;
+}
+
+
+template<typename Alloc>
+typename cx_bitvector<Alloc>::size_type
+cx_bitvector<Alloc>::find_next(size_type pos) const noexcept
+{
+	size_type next = pos + 1;
+	if (next >= nbits) {
+		return npos;
+	}
+
+	size_type w = next / WORD_BITS;
+	word_type rest = words[w] & mask_from(next % WORD_BITS);
+	if (rest != 0) {
+		return w * WORD_BITS + bits::countr_zero(rest);
+	}
+	return find_from_word(w + 1);
+}
+
+
+template<typename Alloc>
+cx_bitvector<Alloc>& cx_bitvector<Alloc>::operator&=(const cx_bitvector& vec) noexcept
+{
+	assert(nbits == vec.nbits);
+	for (size_type w = 0; w < words.size(); ++w) {
+		words[w] &= vec.words[w];
+	}
+	return *this;
+}
+
+
+template<typename Alloc>
+cx_bitvector<Alloc>& cx_bitvector<Alloc>::operator|=(const cx_bitvector& vec) noexcept
+{
+	assert(nbits == vec.nbits);
+	for (size_type w = 0; w < words.size(); ++w) {
+		words[w] |= vec.words[w];
+	}
+	return *this;
+}
+
+
+template<typename Alloc>
+cx_bitvector<Alloc>& cx_bitvector<Alloc>::operator^=(const cx_bitvector& vec) noexcept
+{
+	assert(nbits == vec.nbits);
+	for (size_type w = 0; w < words.size(); ++w) {
+		words[w] ^= vec.words[w];
+	}
+	return *this;
+}
+
+
+template<typename Alloc>
+cx_bitvector<Alloc>& cx_bitvector<Alloc>::and_not(const cx_bitvector& vec) noexcept
+{
+	assert(nbits == vec.nbits);
+	for (size_type w = 0; w < words.size(); ++w) {
+		words[w] &= ~vec.words[w];
+	}
+	return *this;
+}
+
+
+template<typename Alloc>
+cx_bitvector<Alloc> operator&(cx_bitvector<Alloc> lhs, const cx_bitvector<Alloc>& rhs)
+{
+	return lhs &= rhs;
+}
+
+
+template<typename Alloc>
+cx_bitvector<Alloc> operator|(cx_bitvector<Alloc> lhs, const cx_bitvector<Alloc>& rhs)
+{
+	return lhs |= rhs;
+}
+
+
+template<typename Alloc>
+cx_bitvector<Alloc> operator^(cx_bitvector<Alloc> lhs, const cx_bitvector<Alloc>& rhs)
+{
+	return lhs ^= rhs;
+}
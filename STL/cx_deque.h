@@ -5,7 +5,20 @@
 #include <cstdlib>
 #include <initializer_list>
 
+//еԪoperator==<>operator!=<>ҪģѾ
 template<typename T, typename Alloc = free_list_allocator<T>>
+class cx_deque;
+
+template<typename T, typename Alloc>
+bool operator==(const cx_deque<T, Alloc>& lhs,
+				const cx_deque<T, Alloc>& rhs);
+
+template<typename T, typename Alloc>
+bool operator!=(const cx_deque<T, Alloc>& lhs,
+				const cx_deque<T, Alloc>& rhs);
+
+
+template<typename T, typename Alloc>
 class cx_deque
 {
 public:
@@ -296,17 +309,29 @@ public:
 	
 protected:
 	using map_pointer = pointer * ;
+	using alloc_traits = std::allocator_traits<Alloc>;
+	//п뻺ʹͬһʵ
+	using map_allocator_type = typename alloc_traits::template rebind_alloc<pointer>;
 
 public:
-	cx_deque();
-	explicit cx_deque(size_type n, const value_type& value = value_type());
-	explicit cx_deque(std::initializer_list<value_type> list);
-	cx_deque(const cx_deque<T>& deq);
-	cx_deque(cx_deque<T>&& deq) noexcept;
-	cx_deque<T, Alloc>& operator=(const cx_deque<T>& deq);
-	cx_deque<T, Alloc>& operator=(cx_deque<T>&& deq) noexcept;
+	cx_deque(): cx_deque(allocator_type()) {}
+	explicit cx_deque(const allocator_type& alloc);
+	explicit cx_deque(size_type n, const value_type& value = value_type(),
+					  const allocator_type& alloc = allocator_type());
+	explicit cx_deque(std::initializer_list<value_type> list,
+					  const allocator_type& alloc = allocator_type());
+	cx_deque(const cx_deque& deq);
+	cx_deque(const cx_deque& deq, const allocator_type& alloc);
+	cx_deque(cx_deque&& deq) noexcept;
+	cx_deque(cx_deque&& deq, const allocator_type& alloc);
+	cx_deque& operator=(const cx_deque& deq);
+	cx_deque& operator=(cx_deque&& deq) noexcept(
+		alloc_traits::propagate_on_container_move_assignment::value ||
+		alloc_traits::is_always_equal::value);
 	~cx_deque() noexcept;
 
+	allocator_type get_allocator() const noexcept { return allocator; }
+
 	iterator begin() noexcept { return start; }
 	iterator end() noexcept { return finish; }
 	const_iterator cbegin() const noexcept { return start; }
@@ -319,9 +344,8 @@ public:
 	reference back() { return *(finish - 1); }
 	const_reference back() const { return *(finish - 1); }
 	
-	void swap(cx_deque<T>& deq) noexcept;
-	template<typename U>
-	friend void swap(cx_deque<U>& ls, cx_deque<U>& rs) { ls.swap(rs); }
+	void swap(cx_deque& deq) noexcept;
+	friend void swap(cx_deque& ls, cx_deque& rs) noexcept { ls.swap(rs); }
 
 	size_type size() const noexcept { return finish - start; };
 	bool empty() const noexcept { return start == finish; }
@@ -349,9 +373,15 @@ public:
 protected:
 	void create_map(size_type element_num);
 	void reallocate_map(size_type node_to_add, bool add_at_front);
+	void swap_storage(cx_deque& deq) noexcept;
+
+	map_allocator_type map_allocator() const noexcept {
+		return map_allocator_type(allocator);
+	}
 
 
 protected:
+	allocator_type allocator;
 	iterator start;
 	iterator finish;
 
@@ -362,15 +392,15 @@ protected:
 
 
 template<typename T, typename Alloc>
-cx_deque<T, Alloc>::cx_deque()
+cx_deque<T, Alloc>::cx_deque(const allocator_type& alloc): allocator(alloc)
 {
 	size_type init_num = 16;
 	size_type node_num = init_num / buf_size + 1;
 	map_size = std::max(map_size, node_num + 2);
-	map = free_list_allocator<pointer>::allocate(map_size);
+	map = map_allocator().allocate(map_size);
 
 	map_pointer start_ptr = map + (map_size - node_num) / 2;
-	*start_ptr = Alloc::allocate(buf_size);
+	*start_ptr = allocator.allocate(buf_size);
 
 	start.node = start_ptr;
 	start.cur = *(start.node);
@@ -381,52 +411,106 @@ cx_deque<T, Alloc>::cx_deque()
 }
 
 template<typename T, typename Alloc>
-cx_deque<T, Alloc>::cx_deque(size_type n, const value_type& value)
+cx_deque<T, Alloc>::cx_deque(size_type n, const value_type& value,
+							 const allocator_type& alloc): allocator(alloc)
 {
 	create_map(n);
-	finish = std::uninitialized_fill_n(start, n, value);
+	finish = alloc::uninitialized_fill_n(start, n, value);
 }
 
 template<typename T, typename Alloc>
-cx_deque<T, Alloc>::cx_deque(std::initializer_list<T> list)
+cx_deque<T, Alloc>::cx_deque(std::initializer_list<T> list,
+							 const allocator_type& alloc): allocator(alloc)
 {
 	create_map(list.size());
-	finish = std::uninitialized_move(list.begin(), list.end(), start);
+	finish = alloc::uninitialized_copy(list.begin(), list.end(), start);
 }
 
 template<typename T, typename Alloc>
-cx_deque<T, Alloc>::cx_deque(const cx_deque<T>& deq)
+cx_deque<T, Alloc>::cx_deque(const cx_deque& deq):
+	cx_deque(deq,
+		alloc_traits::select_on_container_copy_construction(deq.allocator)) {}
+
+template<typename T, typename Alloc>
+cx_deque<T, Alloc>::cx_deque(const cx_deque& deq, const allocator_type& alloc):
+	allocator(alloc)
 {
 	create_map(deq.size());
-	finish = std::uninitialized_copy(deq.cbegin(), deq.cend(), start);
+	finish = alloc::uninitialized_copy(deq.cbegin(), deq.cend(), start);
 }
 
 template<typename T, typename Alloc>
-cx_deque<T, Alloc>::cx_deque(cx_deque<T>&& deq) noexcept
+cx_deque<T, Alloc>::cx_deque(cx_deque&& deq) noexcept:
+	allocator(std::move(deq.allocator))
 {
 	start = deq.start;
 	finish = deq.finish;
 	map = deq.map;
+	map_size = deq.map_size;
 	
 	deq.start.clear();
 	deq.finish.clear();
 	deq.map = nullptr;
 }
 
+template<typename T, typename Alloc>
+cx_deque<T, Alloc>::cx_deque(cx_deque&& deq, const allocator_type& alloc):
+	allocator(alloc)
+{
+	if (allocator == deq.allocator) {
+		start = deq.start;
+		finish = deq.finish;
+		map = deq.map;
+		map_size = deq.map_size;
+
+		deq.start.clear();
+		deq.finish.clear();
+		deq.map = nullptr;
+		return;
+	}
+
+	//һֻƶԪ
+	create_map(deq.size());
+	finish = alloc::uninitialized_move(deq.start, deq.finish, start);
+}
+
 template<typename T, typename Alloc>
 cx_deque<T, Alloc>&
-cx_deque<T, Alloc>::operator=(cx_deque<T>&& deq) noexcept
+cx_deque<T, Alloc>::operator=(cx_deque&& deq) noexcept(
+	alloc_traits::propagate_on_container_move_assignment::value ||
+	alloc_traits::is_always_equal::value)
 {
-	swap(deq);
+	if (alloc_traits::propagate_on_container_move_assignment::value) {
+		std::swap(allocator, deq.allocator);
+		swap_storage(deq);
+	}
+	else if (allocator == deq.allocator) {
+		swap_storage(deq);
+	}
+	else {
+		cx_deque tmp(std::move(deq), allocator);
+		swap_storage(tmp);
+	}
 	return *this;
 }
 
 template<typename T, typename Alloc>
 cx_deque<T, Alloc>& 
-cx_deque<T, Alloc>::operator=(const cx_deque<T>& deq)
+cx_deque<T, Alloc>::operator=(const cx_deque& deq)
 {
-	cx_deque<T> tmp(deq);
-	swap(tmp);
+	if (this == &deq)
+		return *this;
+
+	//ɿռɵķһ𽻸tmpͷ
+	if (alloc_traits::propagate_on_container_copy_assignment::value) {
+		cx_deque tmp(deq, deq.allocator);
+		std::swap(allocator, tmp.allocator);
+		swap_storage(tmp);
+	}
+	else {
+		cx_deque tmp(deq, allocator);
+		swap_storage(tmp);
+	}
 	return *this;
 }
 
@@ -442,10 +526,10 @@ cx_deque<T, Alloc>::~cx_deque() noexcept
 	for (map_pointer map_ptr = start.node; map_ptr <= finish.node; 
 		 ++map_ptr)
 	{
-		Alloc::deallocate(*map_ptr, buf_size);
+		allocator.deallocate(*map_ptr, buf_size);
 	}
 
-	free_list_allocator<pointer>::deallocate(map, map_size);
+	map_allocator().deallocate(map, map_size);
 }
 
 
@@ -454,14 +538,14 @@ void cx_deque<T, Alloc>::create_map(size_type element_num)
 {
 	size_type node_num = element_num / buf_size + 1;
 	map_size = std::max(map_size, node_num + 2);
-	map = free_list_allocator<pointer>::allocate(map_size);
+	map = map_allocator().allocate(map_size);
 	
 	map_pointer start_ptr, finish_ptr;
 	start_ptr = map + (map_size - node_num) / 2;
 	finish_ptr = start_ptr + node_num - 1;
 	for (map_pointer ptr = start_ptr; ptr <= finish_ptr; ++ptr)
 	{
-		*ptr = Alloc::allocate(buf_size);
+		*ptr = allocator.allocate(buf_size);
 	}
 
 	start.node = start_ptr;
@@ -487,12 +571,12 @@ void cx_deque<T, Alloc>::reallocate_map(size_type node_to_add,
 		finish_ptr = start_ptr + new_node_num - 1;
 
 		if (!add_at_front) {
-			std::copy_n(start.node, old_node_num, start_ptr);
+			alloc::copy(start.node, start.node + old_node_num, start_ptr);
 			start.node = start_ptr;
 			finish.node = start.node + old_node_num - 1;
 		}
 		else {
-			start.node = std::copy_backward(start.node, finish.node + 1, finish_ptr + 1);
+			start.node = alloc::move_backward(start.node, finish.node + 1, finish_ptr + 1);
 			finish.node = finish_ptr;
 		}
 	}
@@ -500,33 +584,44 @@ void cx_deque<T, Alloc>::reallocate_map(size_type node_to_add,
 	{
 		size_type old_map_size = map_size;
 		map_size = map_size + std::max(map_size, node_to_add) + 2;
-		map_pointer new_map = free_list_allocator<pointer>::allocate(map_size);
+		map_pointer new_map = map_allocator().allocate(map_size);
 	
 		start_ptr = new_map + (map_size - new_node_num) / 2;
 		finish_ptr = start_ptr + new_node_num - 1;
 
 		if (!add_at_front) {
-			std::copy_n(start.node, old_node_num, start_ptr);
+			alloc::copy(start.node, start.node + old_node_num, start_ptr);
 			start.node = start_ptr;
 			finish.node = start.node + old_node_num - 1;
 		}
 		else {
-			start.node = std::copy_backward(start.node, finish.node + 1, finish_ptr + 1);
+			start.node = alloc::move_backward(start.node, finish.node + 1, finish_ptr + 1);
 			finish.node = finish_ptr;
 		}
 		
-		free_list_allocator<pointer>::deallocate(map, old_map_size);
+		map_allocator().deallocate(map, old_map_size);
 		map = new_map;
 	}
 }
 
 
 template<typename T, typename Alloc>
-void cx_deque<T, Alloc>::swap(cx_deque<T>& deq) noexcept
+void cx_deque<T, Alloc>::swap_storage(cx_deque& deq) noexcept
 {
 	std::swap(start, deq.start);
 	std::swap(finish, deq.finish);
 	std::swap(map, deq.map);	
+	std::swap(map_size, deq.map_size);
+}
+
+
+template<typename T, typename Alloc>
+void cx_deque<T, Alloc>::swap(cx_deque& deq) noexcept
+{
+	if (alloc_traits::propagate_on_container_swap::value) {
+		std::swap(allocator, deq.allocator);
+	}
+	swap_storage(deq);
 }
 
 
@@ -537,7 +632,7 @@ void cx_deque<T, Alloc>::clear() noexcept
 
 	for (map_pointer node = start.node + 1; node <= finish.node; ++node)
 	{
-		Alloc::deallocate(*node, buf_size);
+		allocator.deallocate(*node, buf_size);
 	}
 
 	start.cur = start.first;
@@ -561,7 +656,7 @@ void cx_deque<T, Alloc>::push_back(const value_type& val)
 		}
 
 		map_pointer next_node = finish.node + 1;
-		*next_node = Alloc::allocate(buf_size);
+		*next_node = allocator.allocate(buf_size);
 		alloc::construct(finish.cur, val);
 		++finish;
 	}
@@ -583,7 +678,7 @@ void cx_deque<T, Alloc>::push_back(value_type&& val)
 		}
 
 		map_pointer next_node = finish.node + 1;
-		*next_node = Alloc::allocate(buf_size);
+		*next_node = allocator.allocate(buf_size);
 		alloc::construct(finish.cur, std::forward<T>(val));
 		++finish;
 	}
@@ -605,7 +700,7 @@ void cx_deque<T, Alloc>::push_front(const value_type& val)
 		}
 
 		map_pointer prev_node = start.node - 1;
-		*prev_node = Alloc::allocate(buf_size);
+		*prev_node = allocator.allocate(buf_size);
 		--start;
 		alloc::construct(start.cur, val);
 	}
@@ -627,7 +722,7 @@ void cx_deque<T, Alloc>::push_front(value_type&& val)
 		}
 
 		map_pointer prev_node = start.node - 1;
-		*prev_node = Alloc::allocate(buf_size);
+		*prev_node = allocator.allocate(buf_size);
 		--start;
 		alloc::construct(start.cur, std::forward<value_type>(val));
 	}
@@ -640,7 +735,7 @@ void cx_deque<T, Alloc>::pop_back()
 {
 	--finish;
 	if(finish.cur == finish.last - 1)
-		Alloc::deallocate(*(finish.node + 1), buf_size);
+		allocator.deallocate(*(finish.node + 1), buf_size);
 	alloc::destroy(finish.cur);
 }
 
@@ -651,7 +746,7 @@ void cx_deque<T, Alloc>::pop_front()
 	alloc::destroy(start.cur);
 	++start;
 	if (start.cur == start.first)
-		Alloc::deallocate(*(start.node - 1), buf_size);
+		allocator.deallocate(*(start.node - 1), buf_size);
 }
 
 
@@ -675,7 +770,7 @@ cx_deque<T, Alloc>::erase(iterator beg, iterator end)
 		alloc::destroy(finish, old_finish);
 		for (map_pointer node = finish.node + 1; node <= old_finish.node;
 			 ++node) {
-			Alloc::deallocate(*node, buf_size);
+			allocator.deallocate(*node, buf_size);
 		}
 
 		return beg;
@@ -688,7 +783,7 @@ cx_deque<T, Alloc>::erase(iterator beg, iterator end)
 		alloc::destroy(old_start, start);
 		for (map_pointer node = old_start.node; node != start.node;
 			 ++node){
-			Alloc::deallocate(*node, buf_size);
+			allocator.deallocate(*node, buf_size);
 		}
 
 		return end;
@@ -1,8 +1,12 @@
 #pragma once
 #include <iterator>
-#include "free_list_allocator.h"
+#include "slab_allocator.h"
 #include "alloc_destroy.h"
+#include "alloc_batch.h"
 #include <initializer_list>
+#include <memory>
+#include <array>
+#include <utility>
 
 
 template<typename T>
@@ -14,7 +18,20 @@ struct list_node
 };
 
 
-template<typename T, typename Alloc = free_list_allocator<list_node<T>>>
+//еԪoperator==<>operator!=<>ҪģѾ
+template<typename T, typename Alloc = slab_allocator<list_node<T>>>
+class cx_list;
+
+template<typename T, typename Alloc>
+bool operator==(const cx_list<T, Alloc>& lhs,
+				const cx_list<T, Alloc>& rhs);
+
+template<typename T, typename Alloc>
+bool operator!=(const cx_list<T, Alloc>& lhs,
+				const cx_list<T, Alloc>& rhs);
+
+
+template<typename T, typename Alloc>
 class cx_list
 {
 protected:
@@ -137,17 +154,33 @@ public:
 	using size_type = std::size_t;
 	using difference_type = std::ptrdiff_t;
 	using allocator_type = Alloc;
+
+protected:
+	//AllocTlist_node<T>ķͳһrebindڵ
+	using node_allocator_type = typename std::allocator_traits<Alloc>::
+		template rebind_alloc<list_node<T>>;
+	using alloc_traits = std::allocator_traits<node_allocator_type>;
 	
 
 public:
-	cx_list();
-	explicit cx_list(std::initializer_list<T> init_val);
-	cx_list(const cx_list<T>& list);
-	cx_list(cx_list<T>&& list) noexcept;
-	cx_list<T, Alloc>& operator=(const cx_list<T>& list);
-	cx_list<T, Alloc>& operator=(cx_list<T>&& list) noexcept;
+	cx_list(): cx_list(allocator_type()) {}
+	explicit cx_list(const allocator_type& alloc);
+	explicit cx_list(std::initializer_list<T> init_val,
+					 const allocator_type& alloc = allocator_type());
+	cx_list(const cx_list& list);
+	cx_list(const cx_list& list, const allocator_type& alloc);
+	cx_list(cx_list&& list) noexcept;
+	cx_list(cx_list&& list, const allocator_type& alloc);
+	cx_list& operator=(const cx_list& list);
+	cx_list& operator=(cx_list&& list) noexcept(
+		alloc_traits::propagate_on_container_move_assignment::value ||
+		alloc_traits::is_always_equal::value);
 	~cx_list() noexcept;
 
+	allocator_type get_allocator() const noexcept {
+		return allocator_type(node_allocator);
+	}
+
 	iterator begin() noexcept { return iterator(last_iter->next); }
 	const_iterator cbegin() const noexcept { return const_iterator(last_iter->next); }
 	iterator end() noexcept { return last_iter; }
@@ -180,30 +213,36 @@ public:
 	void remove(const T& val) noexcept;
 	void unique() noexcept;
 
-	void swap(cx_list<T>& list) noexcept{
-		std::swap(last_iter, list.last_iter);
-		std::swap(list_size, list.list_size);
+	void swap(cx_list& list) noexcept{
+		if (alloc_traits::propagate_on_container_swap::value) {
+			using std::swap;
+			swap(node_allocator, list.node_allocator);
+		}
+		swap_storage(list);
 	}
-	template<typename U>
-	friend void swap(cx_list<U>& ls, cx_list<U>& rs) {
+	friend void swap(cx_list& ls, cx_list& rs) noexcept {
 		ls.swap(rs);
 	}
 	
-	void splice(iterator pos, cx_list<T>& list) {
+	void splice(iterator pos, cx_list& list) {
 		transfer(pos, list.begin(), list.end());
 		list_size += list.size();
+		list.list_size = 0;
 	}
-	void splice(iterator pos, cx_list<T>& list, iterator iter) {
+	void splice(iterator pos, cx_list& list, iterator iter) {
 		transfer(pos, iter, iterator(iter->next));
 		++list_size;
+		--list.list_size;
 	}
-	void splice(iterator pos, cx_list<T>& list,
+	void splice(iterator pos, cx_list& list,
 			    iterator beg, iterator end) {
+		size_type n = std::distance(beg, end);
 		transfer(pos, beg, end);
-		list_size += std::distance(beg, end);
+		list_size += n;
+		list.list_size -= n;
 	}
 
-	void merge(cx_list<T>& list);      //½Ԫת
+	void merge(cx_list& list);      //½Ԫת
 	void reverse() noexcept;
 	void sort();
 
@@ -215,9 +254,24 @@ public:
 
 
 protected:
+	node_allocator_type node_allocator;
 	iterator last_iter;     //ָβ˵Ŀհ׽ڵ
 	size_type list_size;
 
+	void empty_initialize();
+	template<typename InputIterator>
+	void fill_back(InputIterator first, size_type n);   //β˼nԪأڵ
+	void destroy_all() noexcept;                        //ͷųβ˿հ׽ڵнڵ
+	void swap_storage(cx_list& list) noexcept {
+		std::swap(last_iter, list.last_iter);
+		std::swap(list_size, list.list_size);
+	}
+	template<std::size_t... I>
+	static std::array<cx_list, sizeof...(I)>
+		make_lists(const allocator_type& alloc, std::index_sequence<I...>) {
+		return { { ((void)I, cx_list(alloc))... } };
+	}
+
 	iterator create_node();
 	iterator create_node(T&& val);
 	iterator create_node(const T& val);
@@ -227,7 +281,7 @@ protected:
 
 
 template<typename T, typename Alloc>
-cx_list<T, Alloc>::cx_list()
+void cx_list<T, Alloc>::empty_initialize()
 {
 	last_iter = create_node();
 	last_iter->next = last_iter.node_ptr;
@@ -237,34 +291,40 @@ cx_list<T, Alloc>::cx_list()
 
 
 template<typename T, typename Alloc>
-cx_list<T, Alloc>::cx_list(std::initializer_list<T> init_val)
+cx_list<T, Alloc>::cx_list(const allocator_type& alloc):
+	node_allocator(alloc)
 {
-	last_iter = create_node();
-	last_iter->next = last_iter.node_ptr;
-	last_iter->prev = last_iter.node_ptr;
-	list_size = 0;
-
-	for (auto iter = init_val.begin(); iter != init_val.end(); ++iter)
-		push_back(std::move(*iter));
+	empty_initialize();
 }
 
 
 template<typename T, typename Alloc>
-cx_list<T, Alloc>::cx_list(const cx_list<T>& list)
+cx_list<T, Alloc>::cx_list(std::initializer_list<T> init_val,
+						   const allocator_type& alloc):
+	node_allocator(alloc)
 {
-	last_iter = create_node();
-	last_iter->next = last_iter.node_ptr;
-	last_iter->prev = last_iter.node_ptr;
-	list_size = 0;
+	empty_initialize();
+	fill_back(init_val.begin(), init_val.size());
+}
 
-	for (auto iter = list.cbegin(); iter != list.cend(); ++iter)
-	{
-		push_back(*iter);
-	}
+
+template<typename T, typename Alloc>
+cx_list<T, Alloc>::cx_list(const cx_list& list):
+	cx_list(list, allocator_type(alloc_traits::
+		select_on_container_copy_construction(list.node_allocator))) {}
+
+
+template<typename T, typename Alloc>
+cx_list<T, Alloc>::cx_list(const cx_list& list, const allocator_type& alloc):
+	node_allocator(alloc)
+{
+	empty_initialize();
+	fill_back(list.cbegin(), list.size());
 }
 
 template<typename T, typename Alloc>
-cx_list<T, Alloc>::cx_list(cx_list<T>&& list) noexcept
+cx_list<T, Alloc>::cx_list(cx_list&& list) noexcept:
+	node_allocator(std::move(list.node_allocator))
 {
 	this->last_iter = list.last_iter;
 	this->list_size = list.list_size;
@@ -273,21 +333,62 @@ cx_list<T, Alloc>::cx_list(cx_list<T>&& list) noexcept
 }
 
 
+template<typename T, typename Alloc>
+cx_list<T, Alloc>::cx_list(cx_list&& list, const allocator_type& alloc):
+	node_allocator(alloc)
+{
+	if (node_allocator == list.node_allocator) {
+		this->last_iter = list.last_iter;
+		this->list_size = list.list_size;
+		list.last_iter.node_ptr = nullptr;
+		list.list_size = 0;
+		return;
+	}
+
+	//ڵһֻƶԪ
+	empty_initialize();
+	fill_back(std::make_move_iterator(list.begin()), list.size());
+}
+
+
 template<typename T, typename Alloc>
 cx_list<T, Alloc>&
-cx_list<T, Alloc>::operator=(const cx_list<T>& list)
+cx_list<T, Alloc>::operator=(const cx_list& list)
 {
-	cx_list<T> new_list(list);
-	swap(new_list);
+	if (this == &list)
+		return *this;
+
+	//ɽڵɵķһ𽻸new_listͷ
+	if (alloc_traits::propagate_on_container_copy_assignment::value) {
+		cx_list new_list(list, list.get_allocator());
+		std::swap(node_allocator, new_list.node_allocator);
+		swap_storage(new_list);
+	}
+	else {
+		cx_list new_list(list, get_allocator());
+		swap_storage(new_list);
+	}
 	return *this;
 }
 
 
 template<typename T, typename Alloc>
 cx_list<T, Alloc>&
-cx_list<T, Alloc>::operator=(cx_list<T>&& list) noexcept
+cx_list<T, Alloc>::operator=(cx_list&& list) noexcept(
+	alloc_traits::propagate_on_container_move_assignment::value ||
+	alloc_traits::is_always_equal::value)
 {
-	swap(list);
+	if (alloc_traits::propagate_on_container_move_assignment::value) {
+		std::swap(node_allocator, list.node_allocator);
+		swap_storage(list);
+	}
+	else if (node_allocator == list.node_allocator) {
+		swap_storage(list);
+	}
+	else {
+		cx_list new_list(std::move(list), get_allocator());
+		swap_storage(new_list);
+	}
 	return *this;
 }
 
@@ -298,16 +399,51 @@ cx_list<T, Alloc>::~cx_list() noexcept
 	if (!last_iter.node_ptr)
 		return;
 
+	destroy_all();
+	node_allocator.deallocate(last_iter.node_ptr, 1);
+}
+
+
+template<typename T, typename Alloc>
+template<typename InputIterator>
+void cx_list<T, Alloc>::fill_back(InputIterator first, size_type n)
+{
+	alloc::node_batch<node_allocator_type> batch(node_allocator, n);
+
+	for (; n > 0; --n, ++first)
+	{
+		list_node<T> *ptr = batch.get();
+		try {
+			alloc::construct(&(ptr->data), *first);
+		}
+		catch (...) {
+			batch.unget(ptr);
+			throw;
+		}
+
+		iterator prev_node(last_iter->prev);
+		prev_node->next = ptr;
+		ptr->prev = prev_node.node_ptr;
+		ptr->next = last_iter.node_ptr;
+		last_iter->prev = ptr;
+		++list_size;
+	}
+}
+
+
+template<typename T, typename Alloc>
+void cx_list<T, Alloc>::destroy_all() noexcept
+{
+	alloc::node_release<node_allocator_type> release(node_allocator);
+
 	iterator old_iter;
 	for (iterator iter = begin(); iter != end(); )
 	{
 		old_iter = iter;
 		alloc::destroy(&(iter->data));
 		++iter;
-		Alloc::deallocate(old_iter.node_ptr, 1);
+		release.put(old_iter.node_ptr);
 	}
-
-	Alloc::deallocate(last_iter.node_ptr, 1);
 }
 
 
@@ -350,14 +486,7 @@ cx_list<T, Alloc>::insert(iterator pos, T&& val)
 template<typename T, typename Alloc>
 void cx_list<T, Alloc>::clear() noexcept
 {
-	iterator old_iter;
-	for (iterator iter = begin(); iter != end(); )
-	{
-		old_iter = iter;
-		alloc::destroy(&(iter->data));
-		++iter;
-		Alloc::deallocate(old_iter.node_ptr, 1);
-	}
+	destroy_all();
 
 	last_iter->next = last_iter.node_ptr;
 	last_iter->prev = last_iter.node_ptr;
@@ -372,7 +501,6 @@ void cx_list<T, Alloc>::remove(const T& val) noexcept
 	{
 		if (*iter == val) {
 			iter = erase(iter);
-			--list_size;
 			continue;
 		}
 		++iter;
@@ -388,7 +516,6 @@ void cx_list<T, Alloc>::unique() noexcept
 	{
 		if (*prev == *next) {
 			next = erase(next);
-			--list_size;
 			continue;
 		}
 
@@ -399,7 +526,7 @@ void cx_list<T, Alloc>::unique() noexcept
 
 
 template<typename T, typename Alloc>
-void cx_list<T, Alloc>::merge(cx_list<T>& list)
+void cx_list<T, Alloc>::merge(cx_list& list)
 {
 	iterator iter1, iter2;
 
@@ -420,6 +547,7 @@ void cx_list<T, Alloc>::merge(cx_list<T>& list)
 
 	transfer(end(), iter2, list.end());
 	list_size += list.list_size;
+	list.list_size = 0;
 }
 
 
@@ -441,9 +569,11 @@ void cx_list<T, Alloc>::sort()
 	if (size() == 0 || size() == 1)
 		return;
 
-	cx_list<T, Alloc> carry;
+	//뱾÷ڵ֮ת
+	cx_list carry(get_allocator());
 	const std::size_t COUNTER_SIZE = 64;
-	cx_list<T, Alloc> counter[COUNTER_SIZE];
+	std::array<cx_list, COUNTER_SIZE> counter =
+		make_lists(get_allocator(), std::make_index_sequence<COUNTER_SIZE>());
 	int i, limit = -1;
 
 	while (!empty())
@@ -451,7 +581,7 @@ void cx_list<T, Alloc>::sort()
 		i = 0;
 
 		if (counter[i].empty()) {
-			splice(counter[i].begin(), *this, begin());
+			counter[i].splice(counter[i].begin(), *this, begin());
 		}
 		else {
 			carry.splice(carry.begin(), *this, begin());
@@ -479,7 +609,7 @@ template<typename T, typename Alloc>
 typename cx_list<T, Alloc>::iterator
 cx_list<T, Alloc>::create_node()
 {
-	list_node<T> *ptr = Alloc::allocate(1);
+	list_node<T> *ptr = node_allocator.allocate(1);
 	ptr->next = nullptr;
 	ptr->prev = nullptr;
 
@@ -492,7 +622,7 @@ template<typename T, typename Alloc>
 typename cx_list<T, Alloc>::iterator
 cx_list<T, Alloc>::create_node(T&& val)
 {
-	list_node<T> *ptr = Alloc::allocate(1);
+	list_node<T> *ptr = node_allocator.allocate(1);
 	alloc::construct(&(ptr->data), std::forward<T>(val));
 	ptr->next = nullptr;
 	ptr->prev = nullptr;
@@ -505,7 +635,7 @@ template<typename T, typename Alloc>
 typename cx_list<T, Alloc>::iterator
 cx_list<T, Alloc>::create_node(const T& val)
 {
-	list_node<T>* ptr = Alloc::allocate(1);
+	list_node<T>* ptr = node_allocator.allocate(1);
 	alloc::construct(&(ptr->data), val);
 	ptr->next = nullptr;
 	ptr->prev = nullptr;
@@ -525,7 +655,7 @@ void cx_list<T, Alloc>::destroy_node(
 	next_node->prev = prev_node.node_ptr;
 
 	alloc::destroy(&(iter->data));
-	Alloc::deallocate(iter.node_ptr, 1);
+	node_allocator.deallocate(iter.node_ptr, 1);
 	--list_size;
 }
 
@@ -538,6 +668,9 @@ void cx_list<T, Alloc>::transfer(
 		typename cx_list<T, Alloc>::iterator first,
 		typename cx_list<T, Alloc>::iterator last)
 {
+	if (first == last)
+		return;
+
 	iterator prev_pos(pos->prev);
 	iterator prev_first(first->prev);
 	iterator prev_last(last->prev);
@@ -0,0 +1,587 @@
+#pragma once
+#include "alloc_destroy.h"
+#include "bit_util.h"
+#include "free_list_allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+
+/*
+  vector that grows by adding segments instead of moving its elements, so
+  pointers and references stay valid until the element is removed, e.g.
+	cx_segmented_vector<log_entry> log;
+	log_entry *last = &log.emplace_back(...);   //valid after more appends
+  Segment s holds FIRST_SEGMENT << s elements and starts at index
+  FIRST_SEGMENT * (2^s - 1), so the segment of index i is
+  highest_bit(i + FIRST_SEGMENT) - SegmentShift and operator[] is O(1).
+  Growing never copies, and peak memory is the used size plus one segment
+  instead of the old and the new buffer of a reallocation. The table of
+  segment pointers is allocated with the first segment and moves with the
+  segments, so iterators stay valid across move and swap.
+*/
+template<typename T, typename Alloc = free_list_allocator<T>,
+		 std::size_t SegmentShift = 4>
+class cx_segmented_vector
+{
+public:
+	using value_type = T;
+	using pointer = value_type *;
+	using reference = value_type &;
+	using const_reference = const value_type&;
+	using difference_type = std::ptrdiff_t;
+	using size_type = std::size_t;
+	using allocator_type = Alloc;
+
+	static constexpr size_type FIRST_SEGMENT = size_type(1) << SegmentShift;
+	static constexpr size_type SEGMENTS =
+		std::numeric_limits<size_type>::digits - SegmentShift;
+
+	template<bool Const>
+	class basic_iterator;
+	using iterator = basic_iterator<false>;
+	using const_iterator = basic_iterator<true>;
+
+private:
+	using alloc_traits = std::allocator_traits<Alloc>;
+	using table_allocator = typename alloc_traits::template rebind_alloc<T*>;
+
+	allocator_type allocator;
+	T **segments;               //SEGMENTS entries, null until the first segment
+	size_type segment_count;    //allocated segments
+	size_type count;
+	T *finish;         //where the next element goes
+	T *finish_last;    //end of finish's segment
+
+	static size_type segment_size(size_type s) noexcept { return FIRST_SEGMENT << s; }
+	static size_type segment_start(size_type s) noexcept {
+		return (FIRST_SEGMENT << s) - FIRST_SEGMENT;
+	}
+	//segment of index i, offset is i's place in it
+	static size_type locate(size_type i, size_type& offset) noexcept {
+		size_type biased = i + FIRST_SEGMENT;
+		unsigned high = bits::highest_bit(biased);
+		offset = biased - (size_type(1) << high);
+		return high - SegmentShift;
+	}
+
+	void add_segment();
+	void new_segment();
+	void locate_finish() noexcept;
+	void destroy_tail(size_type n) noexcept;
+	void release_storage() noexcept;
+	void swap_storage(cx_segmented_vector& vec) noexcept;
+	template<typename Transfer>
+	void build_from(T *const *from, size_type n, Transfer transfer);
+
+public:
+	iterator begin() noexcept { return iterator(segments, 0); }
+	iterator end() noexcept { return iterator(segments, count); }
+	const_iterator begin() const noexcept { return const_iterator(segments, 0); }
+	const_iterator end() const noexcept { return const_iterator(segments, count); }
+	const_iterator cbegin() const noexcept { return begin(); }
+	const_iterator cend() const noexcept { return end(); }
+
+	size_type size() const noexcept { return count; }
+	size_type capacity() const noexcept { return segment_start(segment_count); }
+	size_type max_size() const noexcept { return alloc_traits::max_size(allocator); }
+	bool empty() const noexcept { return count == 0; }
+	reference operator[](size_type n) {
+		size_type offset;
+		size_type s = locate(n, offset);
+		return segments[s][offset];
+	}
+	const_reference operator[](size_type n) const {
+		size_type offset;
+		size_type s = locate(n, offset);
+		return segments[s][offset];
+	}
+
+	cx_segmented_vector(): cx_segmented_vector(allocator_type()) {}
+	explicit cx_segmented_vector(const allocator_type& alloc) noexcept;
+	cx_segmented_vector(size_type n, const T& value,
+						const allocator_type& alloc = allocator_type()):
+		cx_segmented_vector(alloc) {
+		resize(n, value);
+	}
+	explicit cx_segmented_vector(size_type n, const allocator_type& alloc = allocator_type()):
+		cx_segmented_vector(alloc) {
+		resize(n);
+	}
+	cx_segmented_vector(std::initializer_list<T> list,
+						const allocator_type& alloc = allocator_type());
+	cx_segmented_vector(const cx_segmented_vector& vec);
+	cx_segmented_vector(const cx_segmented_vector& vec, const allocator_type& alloc);
+	cx_segmented_vector(cx_segmented_vector&& vec) noexcept;
+	cx_segmented_vector(cx_segmented_vector&& vec, const allocator_type& alloc);
+	cx_segmented_vector& operator=(const cx_segmented_vector& vec);
+	cx_segmented_vector& operator=(cx_segmented_vector&& vec) noexcept(
+		alloc_traits::propagate_on_container_move_assignment::value ||
+		alloc_traits::is_always_equal::value);
+	~cx_segmented_vector() noexcept { release_storage(); }
+
+	allocator_type get_allocator() const noexcept { return allocator; }
+
+	void swap(cx_segmented_vector& vec) noexcept;
+	friend void swap(cx_segmented_vector& ls, cx_segmented_vector& rs) noexcept
+	{
+		ls.swap(rs);
+	}
+
+	reference front() { return segments[0][0]; }
+	const_reference front() const { return segments[0][0]; }
+	reference back() { return (*this)[count - 1]; }
+	const_reference back() const { return (*this)[count - 1]; }
+
+	void reserve(size_type n);
+	//frees the segments past the last element
+	void shrink_to_fit() noexcept;
+	void resize(size_type n);
+	void resize(size_type n, const T& value);
+
+	void push_back(const T& val) { emplace_back(val); }
+	void push_back(T&& val) { emplace_back(std::move(val)); }
+	template<typename... Args>
+	reference emplace_back(Args&&... args);
+	void pop_back();
+	//keeps the segments for reuse
+	void clear() noexcept { destroy_tail(0); }
+};
+
+
+/*
+  walks one segment by pointer and moves to the next at its end, so
+  iteration does not recompute the segment for every element
+*/
+template<typename T, typename Alloc, std::size_t SegmentShift>
+template<bool Const>
+class cx_segmented_vector<T, Alloc, SegmentShift>::basic_iterator
+{
+	friend class cx_segmented_vector;
+
+public:
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = T;
+	using pointer = typename std::conditional<Const, const T *, T *>::type;
+	using reference = typename std::conditional<Const, const T&, T&>::type;
+	using difference_type = std::ptrdiff_t;
+
+private:
+	T *const *segs;
+	size_type seg;
+	pointer cur;      //null at the start of an unallocated segment, only end() is there
+	pointer first;
+	pointer last;
+
+	basic_iterator(T *const *s, size_type index) noexcept: segs(s) {
+		set_index(index);
+	}
+
+	void set_segment(size_type s) noexcept {
+		seg = s;
+		first = segs ? segs[s] : nullptr;   //no table before the first segment
+		last = first ? first + segment_size(s) : nullptr;
+	}
+	void set_index(size_type index) noexcept {
+		size_type offset;
+		set_segment(locate(index, offset));
+		cur = first ? first + offset : nullptr;
+	}
+	size_type index() const noexcept { return segment_start(seg) + (cur - first); }
+
+public:
+	basic_iterator() noexcept: segs(nullptr), seg(0), cur(nullptr), first(nullptr), last(nullptr) {}
+	//iterator converts to const_iterator
+	template<bool C, typename = typename std::enable_if<Const && !C>::type>
+	basic_iterator(const basic_iterator<C>& it) noexcept:
+		segs(it.segs), seg(it.seg), cur(it.cur), first(it.first), last(it.last) {}
+
+	reference operator*() const { return *cur; }
+	pointer operator->() const { return cur; }
+	reference operator[](difference_type n) const { return *(*this + n); }
+
+	basic_iterator& operator++() noexcept {
+		if (++cur == last) {
+			set_segment(seg + 1);
+			cur = first;
+		}
+		return *this;
+	}
+	basic_iterator operator++(int) noexcept { basic_iterator tmp = *this; ++*this; return tmp; }
+	basic_iterator& operator--() noexcept {
+		if (cur == first) {
+			set_segment(seg - 1);
+			cur = last;
+		}
+		--cur;
+		return *this;
+	}
+	basic_iterator operator--(int) noexcept { basic_iterator tmp = *this; --*this; return tmp; }
+
+	basic_iterator& operator+=(difference_type n) noexcept {
+		set_index(index() + n);
+		return *this;
+	}
+	basic_iterator& operator-=(difference_type n) noexcept { return *this += -n; }
+	basic_iterator operator+(difference_type n) const noexcept {
+		basic_iterator tmp = *this;
+		return tmp += n;
+	}
+	basic_iterator operator-(difference_type n) const noexcept {
+		basic_iterator tmp = *this;
+		return tmp -= n;
+	}
+	difference_type operator-(const basic_iterator& it) const noexcept {
+		return difference_type(index() - it.index());
+	}
+
+	bool operator==(const basic_iterator& it) const noexcept { return cur == it.cur; }
+	bool operator!=(const basic_iterator& it) const noexcept { return cur != it.cur; }
+	bool operator<(const basic_iterator& it) const noexcept { return index() < it.index(); }
+	bool operator>(const basic_iterator& it) const noexcept { return it < *this; }
+	bool operator<=(const basic_iterator& it) const noexcept { return !(it < *this); }
+	bool operator>=(const basic_iterator& it) const noexcept { return !(*this < it); }
+
+	template<bool C>
+	friend class basic_iterator;
+};
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+constexpr std::size_t cx_segmented_vector<T, Alloc, SegmentShift>::FIRST_SEGMENT;
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+constexpr std::size_t cx_segmented_vector<T, Alloc, SegmentShift>::SEGMENTS;
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+cx_segmented_vector<T, Alloc, SegmentShift>::cx_segmented_vector(
+	const allocator_type& alloc) noexcept:
+	allocator(alloc), segments(nullptr), segment_count(0), count(0),
+	finish(nullptr), finish_last(nullptr) {}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+cx_segmented_vector<T, Alloc, SegmentShift>::cx_segmented_vector(
+	std::initializer_list<T> list, const allocator_type& alloc):
+	cx_segmented_vector(alloc)
+{
+	reserve(list.size());
+	for (const T& value : list) {
+		emplace_back(value);
+	}
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+cx_segmented_vector<T, Alloc, SegmentShift>::cx_segmented_vector(
+	const cx_segmented_vector& vec):
+	cx_segmented_vector(vec, alloc_traits::select_on_container_copy_construction(vec.allocator)) {}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+cx_segmented_vector<T, Alloc, SegmentShift>::cx_segmented_vector(
+	const cx_segmented_vector& vec, const allocator_type& alloc):
+	cx_segmented_vector(alloc)
+{
+	build_from(vec.segments, vec.count, [](T *first, T *last, T *dest) {
+		alloc::uninitialized_copy(first, last, dest);
+	});
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+cx_segmented_vector<T, Alloc, SegmentShift>::cx_segmented_vector(
+	cx_segmented_vector&& vec) noexcept:
+	cx_segmented_vector(vec.allocator)
+{
+	swap_storage(vec);
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+cx_segmented_vector<T, Alloc, SegmentShift>::cx_segmented_vector(
+	cx_segmented_vector&& vec, const allocator_type& alloc):
+	cx_segmented_vector(alloc)
+{
+	if (allocator == vec.allocator) {
+		swap_storage(vec);
+	}
+	else {
+		//segments of another allocator cannot be taken over, move the elements
+		build_from(vec.segments, vec.count, [](T *first, T *last, T *dest) {
+			alloc::uninitialized_move(first, last, dest);
+		});
+	}
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+cx_segmented_vector<T, Alloc, SegmentShift>&
+cx_segmented_vector<T, Alloc, SegmentShift>::operator=(const cx_segmented_vector& vec)
+{
+	if (this == &vec) {
+		return *this;
+	}
+
+	if (alloc_traits::propagate_on_container_copy_assignment::value) {
+		//the old segments go back to the allocator that made them
+		if (allocator != vec.allocator) {
+			release_storage();
+		}
+		allocator = vec.allocator;
+	}
+
+	cx_segmented_vector tmp(vec, allocator);
+	swap_storage(tmp);
+	return *this;
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+cx_segmented_vector<T, Alloc, SegmentShift>&
+cx_segmented_vector<T, Alloc, SegmentShift>::operator=(cx_segmented_vector&& vec) noexcept(
+	alloc_traits::propagate_on_container_move_assignment::value ||
+	alloc_traits::is_always_equal::value)
+{
+	if (alloc_traits::propagate_on_container_move_assignment::value) {
+		//vec releases the old segments along with the old allocator
+		using std::swap;
+		swap(allocator, vec.allocator);
+		swap_storage(vec);
+	}
+	else if (allocator == vec.allocator) {
+		swap_storage(vec);
+	}
+	else {
+		cx_segmented_vector tmp(std::move(vec), allocator);
+		swap_storage(tmp);
+	}
+	return *this;
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+void cx_segmented_vector<T, Alloc, SegmentShift>::swap_storage(cx_segmented_vector& vec) noexcept
+{
+	using std::swap;
+	swap(segments, vec.segments);
+	swap(segment_count, vec.segment_count);
+	swap(count, vec.count);
+	swap(finish, vec.finish);
+	swap(finish_last, vec.finish_last);
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+void cx_segmented_vector<T, Alloc, SegmentShift>::swap(cx_segmented_vector& vec) noexcept
+{
+	if (alloc_traits::propagate_on_container_swap::value) {
+		using std::swap;
+		swap(allocator, vec.allocator);
+	}
+	swap_storage(vec);
+}
+
+
+//same layout as from, each segment is built in one run by transfer(first, last, dest)
+template<typename T, typename Alloc, std::size_t SegmentShift>
+template<typename Transfer>
+void cx_segmented_vector<T, Alloc, SegmentShift>::build_from(T *const *from, size_type n,
+															 Transfer transfer)
+{
+	reserve(n);
+	for (size_type s = 0; count < n; ++s)
+	{
+		size_type run = std::min(segment_size(s), n - count);
+		transfer(from[s], from[s] + run, segments[s]);
+		count += run;
+	}
+	locate_finish();
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+void cx_segmented_vector<T, Alloc, SegmentShift>::reserve(size_type n)
+{
+	if (n > max_size()) {
+		throw std::length_error("cx_segmented_vector::reserve");
+	}
+
+	while (capacity() < n) {
+		new_segment();
+	}
+	locate_finish();
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+void cx_segmented_vector<T, Alloc, SegmentShift>::shrink_to_fit() noexcept
+{
+	size_type used = 0;
+	if (count != 0) {
+		size_type offset;
+		used = locate(count - 1, offset) + 1;
+	}
+
+	while (segment_count > used)
+	{
+		--segment_count;
+		allocator.deallocate(segments[segment_count], segment_size(segment_count));
+		segments[segment_count] = nullptr;
+	}
+	locate_finish();
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+void cx_segmented_vector<T, Alloc, SegmentShift>::resize(size_type n)
+{
+	if (n <= count) {
+		destroy_tail(n);
+		return;
+	}
+
+	reserve(n);
+	while (count < n) {
+		emplace_back();
+	}
+}
+
+
+//elements never move, value may be one of them
+template<typename T, typename Alloc, std::size_t SegmentShift>
+void cx_segmented_vector<T, Alloc, SegmentShift>::resize(size_type n, const T& value)
+{
+	if (n <= count) {
+		destroy_tail(n);
+		return;
+	}
+
+	reserve(n);
+	while (count < n) {
+		emplace_back(value);
+	}
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+template<typename... Args>
+typename cx_segmented_vector<T, Alloc, SegmentShift>::reference
+cx_segmented_vector<T, Alloc, SegmentShift>::emplace_back(Args&&... args)
+{
+	if (finish == finish_last) {
+		add_segment();
+	}
+
+	alloc::construct(finish, std::forward<Args>(args)...);
+	++count;
+	return *finish++;
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+void cx_segmented_vector<T, Alloc, SegmentShift>::pop_back()
+{
+	--count;
+	locate_finish();
+	alloc::destroy(finish);
+}
+
+
+//finish is at the end of its segment, start the next one
+template<typename T, typename Alloc, std::size_t SegmentShift>
+void cx_segmented_vector<T, Alloc, SegmentShift>::add_segment()
+{
+	if (count == capacity())
+	{
+		if (count == max_size()) {
+			throw std::length_error("cx_segmented_vector is too long");
+		}
+		new_segment();
+	}
+	locate_finish();
+}
+
+
+//allocates segment segment_count, and the segment table on first use
+template<typename T, typename Alloc, std::size_t SegmentShift>
+void cx_segmented_vector<T, Alloc, SegmentShift>::new_segment()
+{
+	if (segments == nullptr) {
+		table_allocator table(allocator);
+		segments = table.allocate(SEGMENTS);
+		alloc::uninitialized_fill_n(segments, SEGMENTS, static_cast<T*>(nullptr));
+	}
+
+	segments[segment_count] = allocator.allocate(segment_size(segment_count));
+	++segment_count;
+}
+
+
+//points finish at index count, null if its segment is not allocated
+template<typename T, typename Alloc, std::size_t SegmentShift>
+void cx_segmented_vector<T, Alloc, SegmentShift>::locate_finish() noexcept
+{
+	size_type offset;
+	size_type s = locate(count, offset);
+	if (s < segment_count) {
+		finish = segments[s] + offset;
+		finish_last = segments[s] + segment_size(s);
+	}
+	else {
+		finish = finish_last = nullptr;
+	}
+}
+
+
+//destroys the elements from index n on, one segment at a time from the back
+template<typename T, typename Alloc, std::size_t SegmentShift>
+void cx_segmented_vector<T, Alloc, SegmentShift>::destroy_tail(size_type n) noexcept
+{
+	while (count > n)
+	{
+		size_type offset;
+		size_type s = locate(count - 1, offset);
+		size_type from = std::max(n, segment_start(s));
+		alloc::destroy(segments[s] + (from - segment_start(s)), segments[s] + offset + 1);
+		count = from;
+	}
+	locate_finish();
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+void cx_segmented_vector<T, Alloc, SegmentShift>::release_storage() noexcept
+{
+	destroy_tail(0);
+	shrink_to_fit();
+	if (segments != nullptr) {
+		table_allocator table(allocator);
+		table.deallocate(segments, SEGMENTS);
+		segments = nullptr;
+	}
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+bool operator==(const cx_segmented_vector<T, Alloc, SegmentShift>& lhs,
+				const cx_segmented_vector<T, Alloc, SegmentShift>& rhs)
+{
+	return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+
+template<typename T, typename Alloc, std::size_t SegmentShift>
+bool operator!=(const cx_segmented_vector<T, Alloc, SegmentShift>& lhs,
+				const cx_segmented_vector<T, Alloc, SegmentShift>& rhs)
+{
+	return !(lhs == rhs);
+}
@@ -0,0 +1,718 @@
+#pragma once
+#include "cx_vector.h"
+#include "alloc_destroy.h"
+#include <cstddef>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+
+
+/*
+  vector that keeps up to N elements inside the object and only takes
+  memory from Alloc when it grows beyond them, e.g.
+	cx_small_vector<leg, 4> legs;
+  It has cx_vector's interface and copies, moves and relocates elements
+  through the same alloc:: fast paths. Moving a small vector that is
+  still inline moves its elements one by one, it cannot hand over a
+  pointer; swap does the same.
+*/
+template<typename T, std::size_t N, typename Alloc = free_list_allocator<T>,
+		 typename GrowthPolicy = growth_2x>
+class cx_small_vector
+{
+	static_assert(N > 0, "cx_small_vector needs room for at least one element");
+
+public:
+	using value_type = T;
+	using pointer = value_type *;
+	using iterator = value_type *;
+	using const_iterator = const value_type *;
+	using reference = value_type &;
+	using const_reference = const value_type&;
+	using difference_type = std::ptrdiff_t;
+	using size_type = std::size_t;
+	using allocator_type = Alloc;
+	using growth_policy = GrowthPolicy;
+
+	static constexpr std::size_t INLINE_SIZE = N;
+
+private:
+	using alloc_traits = std::allocator_traits<Alloc>;
+
+	template<typename InputIterator>
+	using enable_if_iterator = typename std::enable_if<
+		!std::is_integral<InputIterator>::value>::type;
+
+	allocator_type allocator;
+	iterator start;
+	iterator finish;
+	iterator end_of_storage;
+	alignas(T) unsigned char buffer[N * sizeof(T)];
+
+	iterator inline_storage() noexcept { return reinterpret_cast<T*>(buffer); }
+	void reset_inline() noexcept {
+		start = finish = inline_storage();
+		end_of_storage = start + N;
+	}
+
+	void release_storage() noexcept;
+	void take(cx_small_vector& vec);
+	size_type next_capacity(size_type required) const;
+	template<typename Construct>
+	iterator realloc_insert(iterator pos, size_type n, size_type new_size,
+							Construct construct);
+	void realloc_storage(size_type new_size);
+
+	template<typename InputIterator>
+	void range_initialize(InputIterator first, InputIterator last,
+						  std::input_iterator_tag);
+	template<typename ForwardIterator>
+	void range_initialize(ForwardIterator first, ForwardIterator last,
+						  std::forward_iterator_tag);
+	template<typename InputIterator>
+	iterator range_insert(iterator pos, InputIterator first, InputIterator last,
+						  std::input_iterator_tag);
+	template<typename ForwardIterator>
+	iterator range_insert(iterator pos, ForwardIterator first, ForwardIterator last,
+						  std::forward_iterator_tag);
+	template<typename InputIterator>
+	void range_assign(InputIterator first, InputIterator last,
+					  std::input_iterator_tag);
+	template<typename ForwardIterator>
+	void range_assign(ForwardIterator first, ForwardIterator last,
+					  std::forward_iterator_tag);
+
+public:
+	iterator begin() noexcept { return start; }
+	iterator end() noexcept { return finish; }
+	const_iterator begin() const noexcept { return start; }
+	const_iterator end() const noexcept { return finish; }
+	const_iterator cbegin() const noexcept { return start; }
+	const_iterator cend() const noexcept { return finish; }
+
+	size_type size() const noexcept { return finish - start; }
+	size_type capacity() const noexcept { return end_of_storage - start; }
+	size_type max_size() const noexcept { return alloc_traits::max_size(allocator); }
+	bool empty() const noexcept { return start == finish; }
+	//whether the elements are still inside the object
+	bool is_inline() const noexcept {
+		return start == reinterpret_cast<const T*>(buffer);
+	}
+	reference operator[](size_type n) { return *(start + n); }
+	const_reference operator[](size_type n) const { return *(start + n); }
+
+	cx_small_vector(): cx_small_vector(allocator_type()) {}
+	explicit cx_small_vector(const allocator_type& alloc) noexcept: allocator(alloc) {
+		reset_inline();
+	}
+	cx_small_vector(size_type n, const T& value,
+					const allocator_type& alloc = allocator_type()):
+		cx_small_vector(alloc) {
+		resize(n, value);
+	}
+	explicit cx_small_vector(size_type n, const allocator_type& alloc = allocator_type()):
+		cx_small_vector(alloc) {
+		resize(n);
+	}
+	cx_small_vector(size_type n, cx::default_init_t,
+					const allocator_type& alloc = allocator_type()):
+		cx_small_vector(alloc) {
+		resize_default_init(n);
+	}
+	template<typename InputIterator, typename = enable_if_iterator<InputIterator>>
+	cx_small_vector(InputIterator first, InputIterator last,
+					const allocator_type& alloc = allocator_type());
+	cx_small_vector(std::initializer_list<T> list,
+					const allocator_type& alloc = allocator_type()):
+		cx_small_vector(list.begin(), list.end(), alloc) {}
+	cx_small_vector(const cx_small_vector& vec);
+	cx_small_vector(cx_small_vector&& vec) noexcept(
+		std::is_nothrow_move_constructible<T>::value);
+	cx_small_vector& operator=(const cx_small_vector& vec);
+	cx_small_vector& operator=(cx_small_vector&& vec);
+
+	~cx_small_vector() noexcept { release_storage(); }
+
+	allocator_type get_allocator() const noexcept { return allocator; }
+	void swap(cx_small_vector& vec);
+	friend void swap(cx_small_vector& ls, cx_small_vector& rs)
+	{
+		ls.swap(rs);
+	}
+
+	reference front() { return *start; }
+	const_reference front() const { return *start; }
+	reference back() { return *(finish - 1); }
+	const_reference back() const { return *(finish - 1); }
+
+	void reserve(size_type n);
+	void shrink_to_fit();
+	void resize(size_type n);
+	void resize(size_type n, const T& value);
+	void resize_default_init(size_type n);
+
+	void push_back(const T& val) { emplace_back(val); }
+	void push_back(T&& val) { emplace_back(std::move(val)); }
+	template<typename... Args>
+	reference emplace_back(Args&&... args);
+	template<typename... Args>
+	iterator emplace(iterator pos, Args&&... args);
+	void pop_back();
+	iterator erase(iterator pos) { return erase(pos, pos + 1); }
+	iterator erase(iterator beg, iterator end);
+	void clear() noexcept { erase(start, finish); }
+
+	iterator insert(iterator pos, size_type n, const T& value);
+	iterator insert(iterator pos, const T& val) { return insert(pos, 1, val); }
+	iterator insert(iterator pos, T&& val) { return emplace(pos, std::move(val)); }
+	template<typename InputIterator, typename = enable_if_iterator<InputIterator>>
+	iterator insert(iterator pos, InputIterator first, InputIterator last);
+	template<typename InputIterator, typename = enable_if_iterator<InputIterator>>
+	void assign(InputIterator first, InputIterator last);
+};
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::release_storage() noexcept
+{
+	alloc::destroy(start, finish);
+	if (!is_inline()) {
+		allocator.deallocate(start, capacity());
+	}
+}
+
+
+//*this is inline and empty, and may free what vec allocated
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::take(cx_small_vector& vec)
+{
+	if (vec.is_inline()) {
+		finish = alloc::uninitialized_relocate(vec.start, vec.finish, start);
+		vec.finish = vec.start;
+		return;
+	}
+
+	start = vec.start;
+	finish = vec.finish;
+	end_of_storage = vec.end_of_storage;
+	vec.reset_inline();
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+template<typename InputIterator, typename>
+cx_small_vector<T, N, Alloc, GrowthPolicy>::cx_small_vector(
+	InputIterator first, InputIterator last, const allocator_type& alloc):
+	allocator(alloc)
+{
+	reset_inline();
+	range_initialize(first, last,
+		typename std::iterator_traits<InputIterator>::iterator_category());
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+cx_small_vector<T, N, Alloc, GrowthPolicy>::cx_small_vector(const cx_small_vector& vec):
+	allocator(alloc_traits::select_on_container_copy_construction(vec.allocator))
+{
+	reset_inline();
+	range_initialize(vec.begin(), vec.end(), std::random_access_iterator_tag());
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+cx_small_vector<T, N, Alloc, GrowthPolicy>::cx_small_vector(cx_small_vector&& vec) noexcept(
+	std::is_nothrow_move_constructible<T>::value):
+	allocator(std::move(vec.allocator))
+{
+	reset_inline();
+	take(vec);
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+cx_small_vector<T, N, Alloc, GrowthPolicy>&
+cx_small_vector<T, N, Alloc, GrowthPolicy>::operator=(const cx_small_vector& vec)
+{
+	if (this == &vec)
+		return *this;
+
+	if (alloc_traits::propagate_on_container_copy_assignment::value) {
+		//the old storage goes back to the old allocator
+		if (allocator != vec.allocator) {
+			release_storage();
+			reset_inline();
+		}
+		allocator = vec.allocator;
+	}
+
+	assign(vec.begin(), vec.end());
+	return *this;
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+cx_small_vector<T, N, Alloc, GrowthPolicy>&
+cx_small_vector<T, N, Alloc, GrowthPolicy>::operator=(cx_small_vector&& vec)
+{
+	if (this == &vec)
+		return *this;
+
+	if (alloc_traits::propagate_on_container_move_assignment::value ||
+		allocator == vec.allocator) {
+		release_storage();
+		reset_inline();
+		if (alloc_traits::propagate_on_container_move_assignment::value) {
+			allocator = std::move(vec.allocator);
+		}
+		take(vec);
+	}
+	else {
+		//the storage of another allocator cannot be taken over
+		assign(std::make_move_iterator(vec.begin()), std::make_move_iterator(vec.end()));
+		vec.clear();
+	}
+	return *this;
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::swap(cx_small_vector& vec)
+{
+	if (this == &vec)
+		return;
+
+	cx_small_vector tmp(std::move(vec));
+	vec = std::move(*this);
+	*this = std::move(tmp);
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+template<typename InputIterator>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::range_initialize(
+	InputIterator first, InputIterator last, std::input_iterator_tag)
+{
+	try {
+		for (; first != last; ++first) {
+			emplace_back(*first);
+		}
+	}
+	catch (...) {
+		release_storage();
+		throw;
+	}
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+template<typename ForwardIterator>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::range_initialize(
+	ForwardIterator first, ForwardIterator last, std::forward_iterator_tag)
+{
+	size_type n = std::distance(first, last);
+	if (n > N) {
+		start = allocator.allocate(n);
+		end_of_storage = start + n;
+	}
+
+	try {
+		finish = alloc::uninitialized_copy(first, last, start);
+	}
+	catch (...) {
+		if (!is_inline()) {
+			allocator.deallocate(start, n);
+		}
+		throw;
+	}
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+typename cx_small_vector<T, N, Alloc, GrowthPolicy>::size_type
+cx_small_vector<T, N, Alloc, GrowthPolicy>::next_capacity(size_type required) const
+{
+	if (required > max_size()) {
+		throw std::length_error("cx_small_vector is too long");
+	}
+
+	size_type result = growth_policy()(capacity(), required);
+	return std::min(std::max(result, required), max_size());
+}
+
+
+/*
+  moves the elements to storage for new_size elements, the inline buffer
+  when they fit in it, and leaves n slots at pos built by construct;
+  returns the new pos
+*/
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+template<typename Construct>
+typename cx_small_vector<T, N, Alloc, GrowthPolicy>::iterator
+cx_small_vector<T, N, Alloc, GrowthPolicy>::realloc_insert(
+	iterator pos, size_type n, size_type new_size, Construct construct)
+{
+	bool to_inline = new_size <= N;
+	if (to_inline) {
+		new_size = N;
+	}
+
+	iterator new_start = to_inline ? inline_storage() : allocator.allocate(new_size);
+	iterator new_pos = new_start + (pos - start);
+	//the new elements may come from the old ones, build them first
+	try {
+		construct(new_pos);
+	}
+	catch (...) {
+		if (!to_inline) {
+			allocator.deallocate(new_start, new_size);
+		}
+		throw;
+	}
+
+	//if relocating throws the old elements are intact, drop the new ones
+	iterator new_finish;
+	try {
+		new_finish = alloc::uninitialized_relocate_gap(start, pos, finish, new_start, n);
+	}
+	catch (...) {
+		alloc::destroy(new_pos, new_pos + n);
+		if (!to_inline) {
+			allocator.deallocate(new_start, new_size);
+		}
+		throw;
+	}
+	if (!is_inline()) {
+		allocator.deallocate(start, capacity());
+	}
+
+	start = new_start;
+	finish = new_finish;
+	end_of_storage = start + new_size;
+	return new_pos;
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::realloc_storage(size_type new_size)
+{
+	realloc_insert(finish, 0, new_size, [](iterator) {});
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::reserve(size_type n)
+{
+	if (n > max_size()) {
+		throw std::length_error("cx_small_vector::reserve");
+	}
+	if (n > capacity()) {
+		realloc_storage(n);
+	}
+}
+
+
+//elements that fit go back inside the object
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::shrink_to_fit()
+{
+	if (!is_inline() && finish != end_of_storage) {
+		realloc_storage(size());
+	}
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::resize(size_type n)
+{
+	if (n <= size()) {
+		erase(start + n, finish);
+		return;
+	}
+
+	if (n > capacity()) {
+		realloc_storage(next_capacity(n));
+	}
+	finish = alloc::uninitialized_value_construct_n(finish, n - size());
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::resize(size_type n, const T& value)
+{
+	if (n <= size()) {
+		erase(start + n, finish);
+		return;
+	}
+
+	if (n > capacity()) {
+		//value may be one of the elements that move
+		if (!std::less<const T*>()(&value, start) && std::less<const T*>()(&value, finish)) {
+			T copy(value);
+			resize(n, copy);
+			return;
+		}
+		realloc_storage(next_capacity(n));
+	}
+	finish = alloc::uninitialized_fill_n(finish, n - size(), value);
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::resize_default_init(size_type n)
+{
+	if (n <= size()) {
+		erase(start + n, finish);
+		return;
+	}
+
+	if (n > capacity()) {
+		realloc_storage(next_capacity(n));
+	}
+	finish = alloc::uninitialized_default_construct_n(finish, n - size());
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+template<typename... Args>
+typename cx_small_vector<T, N, Alloc, GrowthPolicy>::reference
+cx_small_vector<T, N, Alloc, GrowthPolicy>::emplace_back(Args&&... args)
+{
+	if (finish != end_of_storage) {
+		alloc::construct(finish, std::forward<Args>(args)...);
+		++finish;
+	}
+	else {
+		emplace(finish, std::forward<Args>(args)...);
+	}
+	return back();
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+template<typename... Args>
+typename cx_small_vector<T, N, Alloc, GrowthPolicy>::iterator
+cx_small_vector<T, N, Alloc, GrowthPolicy>::emplace(iterator pos, Args&&... args)
+{
+	if (finish != end_of_storage)
+	{
+		if (pos == finish) {
+			alloc::construct(finish, std::forward<Args>(args)...);
+		}
+		else {
+			//args may refer to an element that is about to move
+			T tmp(std::forward<Args>(args)...);
+			alloc::construct(finish, std::move(*(finish - 1)));
+			alloc::move_backward(pos, finish - 1, finish);
+			*pos = std::move(tmp);
+		}
+		++finish;
+		return pos;
+	}
+
+	return realloc_insert(pos, 1, next_capacity(size() + 1), [&](iterator gap) {
+		alloc::construct(gap, std::forward<Args>(args)...);
+	});
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::pop_back()
+{
+	--finish;
+	alloc::destroy(finish);
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+typename cx_small_vector<T, N, Alloc, GrowthPolicy>::iterator
+cx_small_vector<T, N, Alloc, GrowthPolicy>::erase(iterator beg, iterator end)
+{
+	if (end != finish) {
+		alloc::move(end, finish, beg);
+	}
+
+	alloc::destroy(finish - (end - beg), finish);
+	finish -= end - beg;
+	return beg;
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+typename cx_small_vector<T, N, Alloc, GrowthPolicy>::iterator
+cx_small_vector<T, N, Alloc, GrowthPolicy>::insert(iterator pos, size_type n,
+												   const T& value)
+{
+	if (size_type(end_of_storage - finish) >= n)
+	{
+		//value may be one of the elements that move
+		T copy(value);
+		size_type elem_after = finish - pos;
+		iterator old_finish = finish;
+
+		if (elem_after > n) {
+			finish = alloc::uninitialized_move(finish - n, finish, finish);
+			alloc::move_backward(pos, old_finish - n, old_finish);
+			std::fill_n(pos, n, copy);
+		}
+		else {
+			finish = alloc::uninitialized_fill_n(finish, n - elem_after, copy);
+			finish = alloc::uninitialized_move(pos, old_finish, finish);
+			std::fill_n(pos, elem_after, copy);
+		}
+		return pos;
+	}
+
+	return realloc_insert(pos, n, next_capacity(size() + n), [&](iterator gap) {
+		alloc::uninitialized_fill_n(gap, n, value);
+	});
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+template<typename InputIterator, typename>
+typename cx_small_vector<T, N, Alloc, GrowthPolicy>::iterator
+cx_small_vector<T, N, Alloc, GrowthPolicy>::insert(iterator pos,
+	InputIterator first, InputIterator last)
+{
+	return range_insert(pos, first, last,
+		typename std::iterator_traits<InputIterator>::iterator_category());
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+template<typename InputIterator>
+typename cx_small_vector<T, N, Alloc, GrowthPolicy>::iterator
+cx_small_vector<T, N, Alloc, GrowthPolicy>::range_insert(iterator pos,
+	InputIterator first, InputIterator last, std::input_iterator_tag)
+{
+	size_type offset = pos - start;
+	size_type old_size = size();
+	for (; first != last; ++first) {
+		emplace_back(*first);
+	}
+
+	std::rotate(start + offset, start + old_size, finish);
+	return start + offset;
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+template<typename ForwardIterator>
+typename cx_small_vector<T, N, Alloc, GrowthPolicy>::iterator
+cx_small_vector<T, N, Alloc, GrowthPolicy>::range_insert(iterator pos,
+	ForwardIterator first, ForwardIterator last, std::forward_iterator_tag)
+{
+	size_type n = std::distance(first, last);
+	if (n == 0) {
+		return pos;
+	}
+
+	if (size_type(end_of_storage - finish) >= n)
+	{
+		size_type elem_after = finish - pos;
+		iterator old_finish = finish;
+
+		if (elem_after > n) {
+			finish = alloc::uninitialized_move(finish - n, finish, finish);
+			alloc::move_backward(pos, old_finish - n, old_finish);
+			alloc::copy(first, last, pos);
+		}
+		else {
+			ForwardIterator mid = first;
+			std::advance(mid, elem_after);
+			finish = alloc::uninitialized_copy(mid, last, finish);
+			finish = alloc::uninitialized_move(pos, old_finish, finish);
+			alloc::copy(first, mid, pos);
+		}
+		return pos;
+	}
+
+	return realloc_insert(pos, n, next_capacity(size() + n), [&](iterator gap) {
+		alloc::uninitialized_copy(first, last, gap);
+	});
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+template<typename InputIterator, typename>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::assign(InputIterator first,
+														InputIterator last)
+{
+	range_assign(first, last,
+		typename std::iterator_traits<InputIterator>::iterator_category());
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+template<typename InputIterator>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::range_assign(
+	InputIterator first, InputIterator last, std::input_iterator_tag)
+{
+	iterator cur = start;
+	for (; first != last && cur != finish; ++first, ++cur) {
+		*cur = *first;
+	}
+
+	if (first == last) {
+		erase(cur, finish);
+		return;
+	}
+	for (; first != last; ++first) {
+		emplace_back(*first);
+	}
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+template<typename ForwardIterator>
+void cx_small_vector<T, N, Alloc, GrowthPolicy>::range_assign(
+	ForwardIterator first, ForwardIterator last, std::forward_iterator_tag)
+{
+	size_type n = std::distance(first, last);
+	if (n > capacity()) {
+		//the old elements are not kept, only allocate
+		clear();
+		realloc_storage(n);
+	}
+
+	if (n <= size()) {
+		iterator new_finish = alloc::copy(first, last, start);
+		alloc::destroy(new_finish, finish);
+		finish = new_finish;
+	}
+	else {
+		ForwardIterator mid = first;
+		std::advance(mid, size());
+		alloc::copy(first, mid, start);
+		finish = alloc::uninitialized_copy(mid, last, finish);
+	}
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+bool operator==(const cx_small_vector<T, N, Alloc, GrowthPolicy>& lhs,
+				const cx_small_vector<T, N, Alloc, GrowthPolicy>& rhs)
+{
+	if (lhs.size() != rhs.size())
+		return false;
+
+	for (std::size_t i = 0; i < lhs.size(); ++i) {
+		if (lhs[i] != rhs[i])
+			return false;
+	}
+
+	return true;
+}
+
+
+template<typename T, std::size_t N, typename Alloc, typename GrowthPolicy>
+bool operator!=(const cx_small_vector<T, N, Alloc, GrowthPolicy>& lhs,
+				const cx_small_vector<T, N, Alloc, GrowthPolicy>& rhs)
+{
+	return !(lhs == rhs);
+}
@@ -0,0 +1,634 @@
+#pragma once
+#include "alloc_destroy.h"
+#include "cx_vector.h"
+#include "malloc_allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+//contiguous run of count elements, what basic_soa_vector::column returns
+template<typename T>
+class column_span
+{
+public:
+	using value_type = typename std::remove_const<T>::type;
+	using pointer = T *;
+	using iterator = T *;
+	using reference = T &;
+	using size_type = std::size_t;
+
+private:
+	T *first;
+	size_type count;
+
+public:
+	column_span() noexcept: first(nullptr), count(0) {}
+	column_span(T *p, size_type n) noexcept: first(p), count(n) {}
+
+	iterator begin() const noexcept { return first; }
+	iterator end() const noexcept { return first + count; }
+	pointer data() const noexcept { return first; }
+	size_type size() const noexcept { return count; }
+	bool empty() const noexcept { return count == 0; }
+	reference operator[](size_type n) const { return first[n]; }
+};
+
+
+
+/*
+  structure of arrays: each field of a row is kept in its own array, e.g.
+	cx_soa_vector<std::uint64_t, double, std::int32_t> orders;  //id, price, qty
+	orders.emplace_back(id, price, qty);
+	for (double p : orders.column<1>()) ...
+  A scan over one field then streams through memory that holds only that
+  field. All columns share one cache line aligned block and one capacity,
+  so a row is added with a single growth check. Iterators yield rows as
+  tuples of references. The block is taken from Alloc rebound to a
+  cache line; cx_soa_vector uses malloc_allocator.
+*/
+template<typename Alloc, typename... Fields>
+class basic_soa_vector
+{
+	static_assert(sizeof...(Fields) > 0, "cx_soa_vector needs at least one field");
+
+public:
+	using allocator_type = Alloc;
+	using value_type = std::tuple<Fields...>;
+	using reference = std::tuple<Fields&...>;
+	using const_reference = std::tuple<const Fields&...>;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+
+	static constexpr std::size_t FIELDS = sizeof...(Fields);
+
+	template<std::size_t I>
+	using field_type = typename std::tuple_element<I, value_type>::type;
+
+	template<bool Const>
+	class basic_iterator;
+	using iterator = basic_iterator<false>;
+	using const_iterator = basic_iterator<true>;
+
+private:
+	static constexpr std::size_t INIT_SIZE = 16;
+
+	struct alignas(CACHE_LINE_SIZE) line
+	{
+		unsigned char bytes[CACHE_LINE_SIZE];
+	};
+
+	using line_allocator =
+		typename std::allocator_traits<Alloc>::template rebind_alloc<line>;
+	using alloc_traits = std::allocator_traits<line_allocator>;
+	using columns_type = std::tuple<Fields*...>;
+	using indices = std::index_sequence_for<Fields...>;
+
+	line_allocator allocator;
+	line *block;
+	columns_type columns;
+	size_type count;
+	size_type cap;
+
+	static size_type lines_for(size_type n, size_type elem_size) {
+		return (n * elem_size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE;
+	}
+	static size_type block_lines(size_type n);
+	template<std::size_t... I>
+	static columns_type layout(line *block, size_type n, std::index_sequence<I...>);
+
+	template<std::size_t... I>
+	static columns_type offset(const columns_type& base, size_type n,
+							   std::index_sequence<I...>) {
+		return columns_type(std::get<I>(base) + n...);
+	}
+
+	template<std::size_t I = 0, typename Build>
+	static void build_columns(const columns_type& to, size_type n, Build& build);
+	template<std::size_t... I>
+	static void destroy_columns(const columns_type& from, size_type n,
+								std::index_sequence<I...>) noexcept;
+
+	template<std::size_t... I>
+	reference row(size_type n, std::index_sequence<I...>) {
+		return reference(std::get<I>(columns)[n]...);
+	}
+	template<std::size_t... I>
+	const_reference row(size_type n, std::index_sequence<I...>) const {
+		return const_reference(std::get<I>(columns)[n]...);
+	}
+
+	template<std::size_t... I>
+	void push_row(const value_type& row, std::index_sequence<I...>) {
+		emplace_back(std::get<I>(row)...);
+	}
+	template<std::size_t... I>
+	void push_row(value_type&& row, std::index_sequence<I...>) {
+		emplace_back(std::get<I>(std::move(row))...);
+	}
+
+	size_type next_capacity(size_type required) const;
+	template<typename Build>
+	void allocate_initialize(size_type n, Build build);
+	template<typename Construct>
+	void realloc_storage(size_type new_size, size_type n, Construct construct);
+	void release_storage() noexcept;
+	void swap_storage(basic_soa_vector& vec) noexcept;
+
+public:
+	basic_soa_vector(): basic_soa_vector(allocator_type()) {}
+	explicit basic_soa_vector(const allocator_type& alloc) noexcept:
+		allocator(alloc), block(nullptr), columns(), count(0), cap(0) {}
+	basic_soa_vector(const basic_soa_vector& vec);
+	basic_soa_vector(const basic_soa_vector& vec, const allocator_type& alloc);
+	basic_soa_vector(basic_soa_vector&& vec) noexcept;
+	basic_soa_vector(basic_soa_vector&& vec, const allocator_type& alloc);
+	basic_soa_vector& operator=(const basic_soa_vector& vec);
+	basic_soa_vector& operator=(basic_soa_vector&& vec) noexcept(
+		alloc_traits::propagate_on_container_move_assignment::value ||
+		alloc_traits::is_always_equal::value);
+	~basic_soa_vector() { release_storage(); }
+
+	allocator_type get_allocator() const noexcept { return allocator_type(allocator); }
+
+	void swap(basic_soa_vector& vec) noexcept;
+	friend void swap(basic_soa_vector& ls, basic_soa_vector& rs) noexcept
+	{
+		ls.swap(rs);
+	}
+
+	iterator begin() noexcept { return iterator(this, 0); }
+	iterator end() noexcept { return iterator(this, count); }
+	const_iterator begin() const noexcept { return const_iterator(this, 0); }
+	const_iterator end() const noexcept { return const_iterator(this, count); }
+	const_iterator cbegin() const noexcept { return begin(); }
+	const_iterator cend() const noexcept { return end(); }
+
+	size_type size() const noexcept { return count; }
+	size_type capacity() const noexcept { return cap; }
+	size_type max_size() const noexcept;
+	bool empty() const noexcept { return count == 0; }
+
+	reference operator[](size_type n) { return row(n, indices()); }
+	const_reference operator[](size_type n) const { return row(n, indices()); }
+	reference front() { return (*this)[0]; }
+	const_reference front() const { return (*this)[0]; }
+	reference back() { return (*this)[count - 1]; }
+	const_reference back() const { return (*this)[count - 1]; }
+
+	//field I of every row, contiguous and aligned to a cache line
+	template<std::size_t I>
+	column_span<field_type<I>> column() noexcept {
+		return column_span<field_type<I>>(std::get<I>(columns), count);
+	}
+	template<std::size_t I>
+	column_span<const field_type<I>> column() const noexcept {
+		return column_span<const field_type<I>>(std::get<I>(columns), count);
+	}
+
+	void reserve(size_type n);
+	void resize(size_type n);
+	void clear() noexcept;
+
+	//one argument per field
+	template<typename... Args>
+	void emplace_back(Args&&... args);
+	void push_back(const value_type& row) { push_row(row, indices()); }
+	void push_back(value_type&& row) { push_row(std::move(row), indices()); }
+	void pop_back();
+};
+
+
+template<typename... Fields>
+using cx_soa_vector = basic_soa_vector<malloc_allocator<char>, Fields...>;
+
+
+template<typename Alloc, typename... Fields>
+template<bool Const>
+class basic_soa_vector<Alloc, Fields...>::basic_iterator
+{
+	friend class basic_soa_vector;
+
+public:
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = std::tuple<Fields...>;
+	using reference = typename std::conditional<Const,
+		std::tuple<const Fields&...>, std::tuple<Fields&...>>::type;
+	using pointer = void;
+	using difference_type = std::ptrdiff_t;
+
+private:
+	using vector_pointer = typename std::conditional<Const,
+		const basic_soa_vector *, basic_soa_vector *>::type;
+
+	vector_pointer vec;
+	std::size_t index;
+
+	basic_iterator(vector_pointer v, std::size_t n) noexcept: vec(v), index(n) {}
+
+public:
+	basic_iterator() noexcept: vec(nullptr), index(0) {}
+	//iterator converts to const_iterator
+	template<bool C, typename = typename std::enable_if<Const && !C>::type>
+	basic_iterator(const basic_iterator<C>& it) noexcept: vec(it.vec), index(it.index) {}
+
+	reference operator*() const { return (*vec)[index]; }
+	reference operator[](difference_type n) const { return (*vec)[index + n]; }
+
+	basic_iterator& operator++() noexcept { ++index; return *this; }
+	basic_iterator operator++(int) noexcept { basic_iterator tmp = *this; ++index; return tmp; }
+	basic_iterator& operator--() noexcept { --index; return *this; }
+	basic_iterator operator--(int) noexcept { basic_iterator tmp = *this; --index; return tmp; }
+	basic_iterator& operator+=(difference_type n) noexcept { index += n; return *this; }
+	basic_iterator& operator-=(difference_type n) noexcept { index -= n; return *this; }
+
+	basic_iterator operator+(difference_type n) const noexcept {
+		return basic_iterator(vec, index + n);
+	}
+	basic_iterator operator-(difference_type n) const noexcept {
+		return basic_iterator(vec, index - n);
+	}
+	difference_type operator-(const basic_iterator& it) const noexcept {
+		return difference_type(index - it.index);
+	}
+
+	bool operator==(const basic_iterator& it) const noexcept { return index == it.index; }
+	bool operator!=(const basic_iterator& it) const noexcept { return index != it.index; }
+	bool operator<(const basic_iterator& it) const noexcept { return index < it.index; }
+	bool operator>(const basic_iterator& it) const noexcept { return index > it.index; }
+	bool operator<=(const basic_iterator& it) const noexcept { return index <= it.index; }
+	bool operator>=(const basic_iterator& it) const noexcept { return index >= it.index; }
+
+	template<bool C>
+	friend class basic_iterator;
+};
+
+
+template<typename Alloc, typename... Fields>
+constexpr std::size_t basic_soa_vector<Alloc, Fields...>::FIELDS;
+
+template<typename Alloc, typename... Fields>
+constexpr std::size_t basic_soa_vector<Alloc, Fields...>::INIT_SIZE;
+
+
+//every column starts on its own cache line
+template<typename Alloc, typename... Fields>
+typename basic_soa_vector<Alloc, Fields...>::size_type
+basic_soa_vector<Alloc, Fields...>::block_lines(size_type n)
+{
+	const size_type sizes[] = { sizeof(Fields)... };
+	size_type result = 0;
+	for (size_type elem_size : sizes) {
+		result += lines_for(n, elem_size);
+	}
+	return result;
+}
+
+
+template<typename Alloc, typename... Fields>
+template<std::size_t... I>
+typename basic_soa_vector<Alloc, Fields...>::columns_type
+basic_soa_vector<Alloc, Fields...>::layout(line *block, size_type n, std::index_sequence<I...>)
+{
+	const size_type sizes[] = { sizeof(Fields)... };
+	size_type offsets[FIELDS] = {};
+	for (size_type i = 1; i < FIELDS; ++i) {
+		offsets[i] = offsets[i - 1] + lines_for(n, sizes[i - 1]);
+	}
+
+	return columns_type(reinterpret_cast<Fields*>(block + offsets[I])...);
+}
+
+
+//build(to column, column index) makes n elements in each column of to,
+//a column that throws has cleaned up after itself, the earlier ones are destroyed
+template<typename Alloc, typename... Fields>
+template<std::size_t I, typename Build>
+void basic_soa_vector<Alloc, Fields...>::build_columns(const columns_type& to, size_type n,
+													   Build& build)
+{
+	if constexpr (I < FIELDS) {
+		build(std::get<I>(to), std::integral_constant<std::size_t, I>());
+		try {
+			build_columns<I + 1>(to, n, build);
+		}
+		catch (...) {
+			alloc::destroy(std::get<I>(to), std::get<I>(to) + n);
+			throw;
+		}
+	}
+}
+
+
+template<typename Alloc, typename... Fields>
+template<std::size_t... I>
+void basic_soa_vector<Alloc, Fields...>::destroy_columns(const columns_type& from, size_type n,
+														 std::index_sequence<I...>) noexcept
+{
+	(alloc::destroy(std::get<I>(from), std::get<I>(from) + n), ...);
+}
+
+
+//build(to column, column index) fills the n rows of a new block
+template<typename Alloc, typename... Fields>
+template<typename Build>
+void basic_soa_vector<Alloc, Fields...>::allocate_initialize(size_type n, Build build)
+{
+	if (n == 0) {
+		return;
+	}
+
+	line *new_block = allocator.allocate(block_lines(n));
+	columns_type new_columns = layout(new_block, n, indices());
+	try {
+		build_columns(new_columns, n, build);
+	}
+	catch (...) {
+		allocator.deallocate(new_block, block_lines(n));
+		throw;
+	}
+
+	block = new_block;
+	columns = new_columns;
+	count = cap = n;
+}
+
+
+template<typename Alloc, typename... Fields>
+basic_soa_vector<Alloc, Fields...>::basic_soa_vector(const basic_soa_vector& vec):
+	basic_soa_vector(vec,
+		alloc_traits::select_on_container_copy_construction(vec.allocator)) {}
+
+
+template<typename Alloc, typename... Fields>
+basic_soa_vector<Alloc, Fields...>::basic_soa_vector(const basic_soa_vector& vec,
+													 const allocator_type& alloc):
+	allocator(alloc), block(nullptr), columns(), count(0), cap(0)
+{
+	auto copy = [&](auto dest, auto index) {
+		auto src = std::get<decltype(index)::value>(vec.columns);
+		alloc::uninitialized_copy(src, src + vec.count, dest);
+	};
+	allocate_initialize(vec.count, copy);
+}
+
+
+template<typename Alloc, typename... Fields>
+basic_soa_vector<Alloc, Fields...>::basic_soa_vector(basic_soa_vector&& vec) noexcept:
+	allocator(std::move(vec.allocator)),
+	block(vec.block), columns(vec.columns), count(vec.count), cap(vec.cap)
+{
+	vec.block = nullptr;
+	vec.columns = columns_type();
+	vec.count = vec.cap = 0;
+}
+
+
+template<typename Alloc, typename... Fields>
+basic_soa_vector<Alloc, Fields...>::basic_soa_vector(basic_soa_vector&& vec,
+													 const allocator_type& alloc):
+	allocator(alloc), block(nullptr), columns(), count(0), cap(0)
+{
+	if (allocator == vec.allocator) {
+		swap_storage(vec);
+	}
+	else {
+		//a block of another allocator cannot be taken over, move the rows
+		auto move = [&](auto dest, auto index) {
+			auto src = std::get<decltype(index)::value>(vec.columns);
+			alloc::uninitialized_move(src, src + vec.count, dest);
+		};
+		allocate_initialize(vec.count, move);
+	}
+}
+
+
+template<typename Alloc, typename... Fields>
+basic_soa_vector<Alloc, Fields...>&
+basic_soa_vector<Alloc, Fields...>::operator=(const basic_soa_vector& vec)
+{
+	if (this == &vec) {
+		return *this;
+	}
+
+	if (alloc_traits::propagate_on_container_copy_assignment::value) {
+		//the old block goes back to the allocator that made it
+		if (allocator != vec.allocator) {
+			release_storage();
+			block = nullptr;
+			columns = columns_type();
+			count = cap = 0;
+		}
+		allocator = vec.allocator;
+	}
+
+	basic_soa_vector tmp(vec, allocator_type(allocator));
+	swap_storage(tmp);
+	return *this;
+}
+
+
+template<typename Alloc, typename... Fields>
+basic_soa_vector<Alloc, Fields...>&
+basic_soa_vector<Alloc, Fields...>::operator=(basic_soa_vector&& vec) noexcept(
+	alloc_traits::propagate_on_container_move_assignment::value ||
+	alloc_traits::is_always_equal::value)
+{
+	if (alloc_traits::propagate_on_container_move_assignment::value) {
+		//vec releases the old block along with the old allocator
+		using std::swap;
+		swap(allocator, vec.allocator);
+		swap_storage(vec);
+	}
+	else if (allocator == vec.allocator) {
+		swap_storage(vec);
+	}
+	else {
+		basic_soa_vector tmp(std::move(vec), allocator_type(allocator));
+		swap_storage(tmp);
+	}
+	return *this;
+}
+
+
+template<typename Alloc, typename... Fields>
+void basic_soa_vector<Alloc, Fields...>::swap_storage(basic_soa_vector& vec) noexcept
+{
+	std::swap(block, vec.block);
+	std::swap(columns, vec.columns);
+	std::swap(count, vec.count);
+	std::swap(cap, vec.cap);
+}
+
+
+template<typename Alloc, typename... Fields>
+void basic_soa_vector<Alloc, Fields...>::swap(basic_soa_vector& vec) noexcept
+{
+	if (alloc_traits::propagate_on_container_swap::value) {
+		using std::swap;
+		swap(allocator, vec.allocator);
+	}
+	swap_storage(vec);
+}
+
+
+template<typename Alloc, typename... Fields>
+typename basic_soa_vector<Alloc, Fields...>::size_type
+basic_soa_vector<Alloc, Fields...>::max_size() const noexcept
+{
+	constexpr size_type row_size = (sizeof(Fields) + ...);
+	//each column may waste up to a line on padding
+	return (PTRDIFF_MAX - FIELDS * CACHE_LINE_SIZE) / row_size;
+}
+
+
+template<typename Alloc, typename... Fields>
+void basic_soa_vector<Alloc, Fields...>::reserve(size_type n)
+{
+	if (n > max_size()) {
+		throw std::length_error("cx_soa_vector::reserve");
+	}
+	if (n > cap) {
+		realloc_storage(n, 0, [](const columns_type&) {});
+	}
+}
+
+
+template<typename Alloc, typename... Fields>
+void basic_soa_vector<Alloc, Fields...>::resize(size_type n)
+{
+	if (n <= count) {
+		columns_type tail = offset(columns, n, indices());
+		destroy_columns(tail, count - n, indices());
+		count = n;
+		return;
+	}
+
+	if (n > cap) {
+		realloc_storage(next_capacity(n), 0, [](const columns_type&) {});
+	}
+	size_type added = n - count;
+	auto value_init = [&](auto dest, auto) {
+		alloc::uninitialized_value_construct_n(dest, added);
+	};
+	build_columns(offset(columns, count, indices()), added, value_init);
+	count = n;
+}
+
+
+template<typename Alloc, typename... Fields>
+void basic_soa_vector<Alloc, Fields...>::clear() noexcept
+{
+	destroy_columns(columns, count, indices());
+	count = 0;
+}
+
+
+template<typename Alloc, typename... Fields>
+template<typename... Args>
+void basic_soa_vector<Alloc, Fields...>::emplace_back(Args&&... args)
+{
+	static_assert(sizeof...(Args) == FIELDS, "emplace_back takes one argument per field");
+
+	auto fields = std::forward_as_tuple(std::forward<Args>(args)...);
+	auto construct = [&](auto dest, auto index) {
+		alloc::construct(dest, std::get<decltype(index)::value>(std::move(fields)));
+	};
+	auto construct_row = [&](const columns_type& slot) {
+		build_columns(slot, 1, construct);
+	};
+
+	if (count == cap) {
+		//args may refer to rows in the old block, build the new row first
+		realloc_storage(next_capacity(count + 1), 1, construct_row);
+	}
+	else {
+		construct_row(offset(columns, count, indices()));
+	}
+	++count;
+}
+
+
+template<typename Alloc, typename... Fields>
+void basic_soa_vector<Alloc, Fields...>::pop_back()
+{
+	--count;
+	destroy_columns(offset(columns, count, indices()), 1, indices());
+}
+
+
+//at least required rows
+template<typename Alloc, typename... Fields>
+typename basic_soa_vector<Alloc, Fields...>::size_type
+basic_soa_vector<Alloc, Fields...>::next_capacity(size_type required) const
+{
+	if (required > max_size()) {
+		throw std::length_error("cx_soa_vector is too long");
+	}
+
+	size_type result = cap == 0 ? INIT_SIZE : growth_2x()(cap, required);
+	return std::min(std::max(result, required), max_size());
+}
+
+
+/*
+  moves all columns to a block of new_size rows, construct(row slot) first
+  builds the n rows after the last one in the new block. A field whose
+  move may throw is copied instead, so either every column moves or the
+  vector is left as it was, unless a move-only field throws on move.
+*/
+template<typename Alloc, typename... Fields>
+template<typename Construct>
+void basic_soa_vector<Alloc, Fields...>::realloc_storage(size_type new_size, size_type n,
+														 Construct construct)
+{
+	line *new_block = allocator.allocate(block_lines(new_size));
+	columns_type new_columns = layout(new_block, new_size, indices());
+	auto move = [&](auto dest, auto index) {
+		using F = field_type<decltype(index)::value>;
+		auto src = std::get<decltype(index)::value>(columns);
+		if constexpr (std::is_nothrow_move_constructible<F>::value ||
+					  !std::is_copy_constructible<F>::value) {
+			alloc::uninitialized_move(src, src + count, dest);
+		}
+		else {
+			alloc::uninitialized_copy(src, src + count, dest);
+		}
+	};
+
+	try {
+		construct(offset(new_columns, count, indices()));
+		try {
+			build_columns(new_columns, count, move);
+		}
+		catch (...) {
+			destroy_columns(offset(new_columns, count, indices()), n, indices());
+			throw;
+		}
+	}
+	catch (...) {
+		allocator.deallocate(new_block, block_lines(new_size));
+		throw;
+	}
+
+	release_storage();
+	block = new_block;
+	columns = new_columns;
+	cap = new_size;
+}
+
+
+template<typename Alloc, typename... Fields>
+void basic_soa_vector<Alloc, Fields...>::release_storage() noexcept
+{
+	if (block) {
+		destroy_columns(columns, count, indices());
+		allocator.deallocate(block, block_lines(cap));
+	}
+}
@@ -0,0 +1,599 @@
+#pragma once
+#include "alloc_destroy.h"
+#include "cx_vector.h"
+#include <cstddef>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+//C++20 lets constant evaluation leave storage uninitialized
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201907L
+#define CX_CONSTEXPR_UNINITIALIZED
+#endif
+
+
+/*
+  element storage of cx_static_vector. cx_static_vector is trivially
+  copyable whenever T is trivially copyable and destructible. For
+  trivial T the storage is a plain array, which makes it usable in
+  constexpr functions; before C++20 the array has to be zeroed on
+  construction for that. Other types live in a union that leaves the
+  slots uninitialized until an element is built in them, with copies
+  left to the compiler when T allows it.
+*/
+template<typename T, std::size_t Capacity,
+		 bool = std::is_trivially_copyable<T>::value &&
+				std::is_trivially_destructible<T>::value,
+		 bool = std::is_trivial<T>::value>
+struct static_vector_storage;
+
+
+template<typename T, std::size_t Capacity>
+struct static_vector_storage<T, Capacity, true, true>
+{
+	T elems[Capacity];
+	std::size_t count;
+
+#ifdef CX_CONSTEXPR_UNINITIALIZED
+	constexpr static_vector_storage() noexcept: count(0) {}
+#else
+	constexpr static_vector_storage() noexcept: elems(), count(0) {}
+#endif
+};
+
+
+//e.g. a type with default member initializers
+template<typename T, std::size_t Capacity>
+struct static_vector_storage<T, Capacity, true, false>
+{
+	union
+	{
+		char unused;
+		T elems[Capacity];
+	};
+	std::size_t count;
+
+	static_vector_storage() noexcept: unused(), count(0) {}
+};
+
+
+template<typename T, std::size_t Capacity, bool Trivial>
+struct static_vector_storage<T, Capacity, false, Trivial>
+{
+	union
+	{
+		char unused;
+		T elems[Capacity];
+	};
+	std::size_t count;
+
+	static_vector_storage() noexcept: unused(), count(0) {}
+
+	static_vector_storage(const static_vector_storage& s): unused(), count(0) {
+		alloc::uninitialized_copy(s.elems, s.elems + s.count, elems);
+		count = s.count;
+	}
+
+	//the elements of s are moved from, not removed
+	static_vector_storage(static_vector_storage&& s) noexcept(
+		std::is_nothrow_move_constructible<T>::value): unused(), count(0) {
+		alloc::uninitialized_move(s.elems, s.elems + s.count, elems);
+		count = s.count;
+	}
+
+	static_vector_storage& operator=(const static_vector_storage& s) {
+		if (this != &s) {
+			assign(s.elems, s.count);
+		}
+		return *this;
+	}
+
+	static_vector_storage& operator=(static_vector_storage&& s) {
+		if (this != &s) {
+			assign(std::make_move_iterator(s.elems), s.count);
+		}
+		return *this;
+	}
+
+	~static_vector_storage() { alloc::destroy(elems, elems + count); }
+
+	template<typename InputIterator>
+	void assign(InputIterator first, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i < n && i < count; ++i, ++first) {
+			elems[i] = *first;
+		}
+
+		if (n < count) {
+			alloc::destroy(elems + n, elems + count);
+			count = n;
+			return;
+		}
+		for (; i < n; ++i, ++first) {
+			alloc::construct(elems + i, *first);
+			count = i + 1;
+		}
+	}
+};
+
+
+
+/*
+  vector of at most Capacity elements kept inside the object, it never
+  allocates, e.g. as scratch space in a hot loop
+	cx_static_vector<order*, 64> matched;
+  Growing past Capacity throws std::length_error and leaves the vector
+  as it was; try_emplace_back and try_push_back return nullptr instead.
+  It has cx_vector's interface without the capacity management.
+*/
+template<typename T, std::size_t Capacity>
+class cx_static_vector
+{
+	static_assert(Capacity > 0, "cx_static_vector needs room for at least one element");
+
+public:
+	using value_type = T;
+	using pointer = value_type *;
+	using iterator = value_type *;
+	using const_iterator = const value_type *;
+	using reference = value_type &;
+	using const_reference = const value_type&;
+	using difference_type = std::ptrdiff_t;
+	using size_type = std::size_t;
+
+private:
+	using trivial = std::integral_constant<bool, std::is_trivial<T>::value>;
+
+	template<typename InputIterator>
+	using enable_if_iterator = typename std::enable_if<
+		!std::is_integral<InputIterator>::value>::type;
+
+	static_vector_storage<T, Capacity> storage;
+
+	//trivial elements are assigned, which constant evaluation allows
+	template<typename... Args>
+	constexpr void construct_at(size_type i, Args&&... args) {
+		aux_construct_at(trivial(), i, std::forward<Args>(args)...);
+	}
+	template<typename... Args>
+	constexpr void aux_construct_at(std::true_type, size_type i, Args&&... args) {
+		storage.elems[i] = T(std::forward<Args>(args)...);
+	}
+	template<typename... Args>
+	void aux_construct_at(std::false_type, size_type i, Args&&... args) {
+		alloc::construct(storage.elems + i, std::forward<Args>(args)...);
+	}
+
+	constexpr void destroy_range(size_type first, size_type last) noexcept {
+		aux_destroy_range(trivial(), first, last);
+	}
+	constexpr void aux_destroy_range(std::true_type, size_type, size_type) noexcept {}
+	void aux_destroy_range(std::false_type, size_type first, size_type last) noexcept {
+		alloc::destroy(storage.elems + first, storage.elems + last);
+	}
+
+	constexpr void check_room(size_type n) const;
+	constexpr void open_gap(size_type i, size_type n);
+	template<typename U>
+	constexpr void fill_gap(size_type j, size_type old_count, U&& value);
+
+	template<typename InputIterator>
+	iterator range_insert(iterator pos, InputIterator first, InputIterator last,
+						  std::input_iterator_tag);
+	template<typename ForwardIterator>
+	constexpr iterator range_insert(iterator pos, ForwardIterator first,
+									ForwardIterator last, std::forward_iterator_tag);
+	template<typename InputIterator>
+	void range_assign(InputIterator first, InputIterator last,
+					  std::input_iterator_tag);
+	template<typename ForwardIterator>
+	constexpr void range_assign(ForwardIterator first, ForwardIterator last,
+								std::forward_iterator_tag);
+
+public:
+	constexpr iterator begin() noexcept { return storage.elems; }
+	constexpr iterator end() noexcept { return storage.elems + storage.count; }
+	constexpr const_iterator begin() const noexcept { return storage.elems; }
+	constexpr const_iterator end() const noexcept { return storage.elems + storage.count; }
+	constexpr const_iterator cbegin() const noexcept { return begin(); }
+	constexpr const_iterator cend() const noexcept { return end(); }
+
+	constexpr size_type size() const noexcept { return storage.count; }
+	static constexpr size_type capacity() noexcept { return Capacity; }
+	static constexpr size_type max_size() noexcept { return Capacity; }
+	constexpr bool empty() const noexcept { return storage.count == 0; }
+	constexpr bool full() const noexcept { return storage.count == Capacity; }
+	constexpr reference operator[](size_type n) { return storage.elems[n]; }
+	constexpr const_reference operator[](size_type n) const { return storage.elems[n]; }
+
+	constexpr cx_static_vector() noexcept {}
+	constexpr cx_static_vector(size_type n, const T& value) { resize(n, value); }
+	constexpr explicit cx_static_vector(size_type n) { resize(n); }
+	constexpr cx_static_vector(size_type n, cx::default_init_t) { resize_default_init(n); }
+	template<typename InputIterator, typename = enable_if_iterator<InputIterator>>
+	constexpr cx_static_vector(InputIterator first, InputIterator last) { assign(first, last); }
+	constexpr cx_static_vector(std::initializer_list<T> list) {
+		assign(list.begin(), list.end());
+	}
+
+	void swap(cx_static_vector& vec);
+	friend void swap(cx_static_vector& ls, cx_static_vector& rs)
+	{
+		ls.swap(rs);
+	}
+
+	constexpr reference front() { return storage.elems[0]; }
+	constexpr const_reference front() const { return storage.elems[0]; }
+	constexpr reference back() { return storage.elems[storage.count - 1]; }
+	constexpr const_reference back() const { return storage.elems[storage.count - 1]; }
+
+	constexpr void resize(size_type n);
+	constexpr void resize(size_type n, const T& value);
+	constexpr void resize_default_init(size_type n);
+
+	constexpr void push_back(const T& val) { emplace_back(val); }
+	constexpr void push_back(T&& val) { emplace_back(std::move(val)); }
+	template<typename... Args>
+	constexpr reference emplace_back(Args&&... args);
+	//nullptr when full
+	template<typename... Args>
+	constexpr pointer try_emplace_back(Args&&... args);
+	constexpr pointer try_push_back(const T& val) { return try_emplace_back(val); }
+	constexpr pointer try_push_back(T&& val) { return try_emplace_back(std::move(val)); }
+	template<typename... Args>
+	constexpr iterator emplace(iterator pos, Args&&... args);
+	constexpr void pop_back();
+	constexpr iterator erase(iterator pos) { return erase(pos, pos + 1); }
+	constexpr iterator erase(iterator beg, iterator end);
+	constexpr void clear() noexcept {
+		destroy_range(0, storage.count);
+		storage.count = 0;
+	}
+
+	constexpr iterator insert(iterator pos, size_type n, const T& value);
+	constexpr iterator insert(iterator pos, const T& val) { return insert(pos, 1, val); }
+	constexpr iterator insert(iterator pos, T&& val) { return emplace(pos, std::move(val)); }
+	template<typename InputIterator, typename = enable_if_iterator<InputIterator>>
+	constexpr iterator insert(iterator pos, InputIterator first, InputIterator last);
+	template<typename InputIterator, typename = enable_if_iterator<InputIterator>>
+	constexpr void assign(InputIterator first, InputIterator last);
+};
+
+
+template<typename T, std::size_t Capacity>
+constexpr void cx_static_vector<T, Capacity>::check_room(size_type n) const
+{
+	if (n > Capacity - storage.count) {
+		throw std::length_error("cx_static_vector is full");
+	}
+}
+
+
+//moves [i, size()) up by n, [i, i + n) then holds moved-from or no objects
+template<typename T, std::size_t Capacity>
+constexpr void cx_static_vector<T, Capacity>::open_gap(size_type i, size_type n)
+{
+	for (size_type k = storage.count; k > i; --k)
+	{
+		size_type from = k - 1;
+		if (from + n >= storage.count) {
+			construct_at(from + n, std::move(storage.elems[from]));
+		}
+		else {
+			storage.elems[from + n] = std::move(storage.elems[from]);
+		}
+	}
+}
+
+
+//slot j of a gap opened when the size was old_count
+template<typename T, std::size_t Capacity>
+template<typename U>
+constexpr void cx_static_vector<T, Capacity>::fill_gap(size_type j, size_type old_count,
+													   U&& value)
+{
+	if (j < old_count) {
+		storage.elems[j] = std::forward<U>(value);
+	}
+	else {
+		construct_at(j, std::forward<U>(value));
+	}
+}
+
+
+template<typename T, std::size_t Capacity>
+void cx_static_vector<T, Capacity>::swap(cx_static_vector& vec)
+{
+	cx_static_vector *longer = this, *shorter = &vec;
+	if (longer->size() < shorter->size()) {
+		std::swap(longer, shorter);
+	}
+
+	using std::swap;
+	size_type common = shorter->size();
+	for (size_type i = 0; i < common; ++i) {
+		swap(storage.elems[i], vec.storage.elems[i]);
+	}
+
+	for (size_type i = common; i < longer->size(); ++i) {
+		shorter->construct_at(i, std::move(longer->storage.elems[i]));
+		shorter->storage.count = i + 1;
+	}
+	longer->destroy_range(common, longer->size());
+	longer->storage.count = common;
+}
+
+
+template<typename T, std::size_t Capacity>
+constexpr void cx_static_vector<T, Capacity>::resize(size_type n)
+{
+	if (n <= storage.count) {
+		erase(begin() + n, end());
+		return;
+	}
+
+	check_room(n - storage.count);
+	for (; storage.count < n; ++storage.count) {
+		construct_at(storage.count);
+	}
+}
+
+
+//elements never move here, value may be one of them
+template<typename T, std::size_t Capacity>
+constexpr void cx_static_vector<T, Capacity>::resize(size_type n, const T& value)
+{
+	if (n <= storage.count) {
+		erase(begin() + n, end());
+		return;
+	}
+
+	check_room(n - storage.count);
+	for (; storage.count < n; ++storage.count) {
+		construct_at(storage.count, value);
+	}
+}
+
+
+template<typename T, std::size_t Capacity>
+constexpr void cx_static_vector<T, Capacity>::resize_default_init(size_type n)
+{
+	if (n <= storage.count) {
+		erase(begin() + n, end());
+		return;
+	}
+
+	check_room(n - storage.count);
+	if (trivial::value) {
+		storage.count = n;
+		return;
+	}
+	for (; storage.count < n; ++storage.count) {
+		construct_at(storage.count);
+	}
+}
+
+
+template<typename T, std::size_t Capacity>
+template<typename... Args>
+constexpr typename cx_static_vector<T, Capacity>::reference
+cx_static_vector<T, Capacity>::emplace_back(Args&&... args)
+{
+	check_room(1);
+	construct_at(storage.count, std::forward<Args>(args)...);
+	++storage.count;
+	return back();
+}
+
+
+template<typename T, std::size_t Capacity>
+template<typename... Args>
+constexpr typename cx_static_vector<T, Capacity>::pointer
+cx_static_vector<T, Capacity>::try_emplace_back(Args&&... args)
+{
+	if (full()) {
+		return nullptr;
+	}
+
+	construct_at(storage.count, std::forward<Args>(args)...);
+	++storage.count;
+	return &back();
+}
+
+
+template<typename T, std::size_t Capacity>
+template<typename... Args>
+constexpr typename cx_static_vector<T, Capacity>::iterator
+cx_static_vector<T, Capacity>::emplace(iterator pos, Args&&... args)
+{
+	check_room(1);
+	size_type i = pos - begin();
+	if (i == storage.count) {
+		construct_at(i, std::forward<Args>(args)...);
+		++storage.count;
+		return pos;
+	}
+
+	//args may refer to an element that is about to move
+	T tmp(std::forward<Args>(args)...);
+	size_type old_count = storage.count;
+	open_gap(i, 1);
+	fill_gap(i, old_count, std::move(tmp));
+	storage.count = old_count + 1;
+	return pos;
+}
+
+
+template<typename T, std::size_t Capacity>
+constexpr void cx_static_vector<T, Capacity>::pop_back()
+{
+	--storage.count;
+	destroy_range(storage.count, storage.count + 1);
+}
+
+
+template<typename T, std::size_t Capacity>
+constexpr typename cx_static_vector<T, Capacity>::iterator
+cx_static_vector<T, Capacity>::erase(iterator beg, iterator end)
+{
+	size_type first = beg - begin();
+	size_type n = end - beg;
+	for (size_type i = first + n; i < storage.count; ++i) {
+		storage.elems[i - n] = std::move(storage.elems[i]);
+	}
+
+	destroy_range(storage.count - n, storage.count);
+	storage.count -= n;
+	return beg;
+}
+
+
+template<typename T, std::size_t Capacity>
+constexpr typename cx_static_vector<T, Capacity>::iterator
+cx_static_vector<T, Capacity>::insert(iterator pos, size_type n, const T& value)
+{
+	check_room(n);
+	size_type i = pos - begin();
+	//value may be an element that is about to move
+	T copy(value);
+	size_type old_count = storage.count;
+	open_gap(i, n);
+	for (size_type j = i; j < i + n; ++j) {
+		fill_gap(j, old_count, copy);
+	}
+	storage.count = old_count + n;
+	return pos;
+}
+
+
+template<typename T, std::size_t Capacity>
+template<typename InputIterator, typename>
+constexpr typename cx_static_vector<T, Capacity>::iterator
+cx_static_vector<T, Capacity>::insert(iterator pos, InputIterator first, InputIterator last)
+{
+	return range_insert(pos, first, last,
+		typename std::iterator_traits<InputIterator>::iterator_category());
+}
+
+
+//the count is unknown, append and rotate into place
+template<typename T, std::size_t Capacity>
+template<typename InputIterator>
+typename cx_static_vector<T, Capacity>::iterator
+cx_static_vector<T, Capacity>::range_insert(iterator pos,
+	InputIterator first, InputIterator last, std::input_iterator_tag)
+{
+	size_type i = pos - begin();
+	size_type old_count = storage.count;
+	try {
+		for (; first != last; ++first) {
+			emplace_back(*first);
+		}
+	}
+	catch (...) {
+		destroy_range(old_count, storage.count);
+		storage.count = old_count;
+		throw;
+	}
+
+	std::rotate(begin() + i, begin() + old_count, end());
+	return pos;
+}
+
+
+template<typename T, std::size_t Capacity>
+template<typename ForwardIterator>
+constexpr typename cx_static_vector<T, Capacity>::iterator
+cx_static_vector<T, Capacity>::range_insert(iterator pos,
+	ForwardIterator first, ForwardIterator last, std::forward_iterator_tag)
+{
+	size_type n = std::distance(first, last);
+	check_room(n);
+	size_type i = pos - begin();
+	size_type old_count = storage.count;
+	open_gap(i, n);
+	for (size_type j = i; j < i + n; ++j, ++first) {
+		fill_gap(j, old_count, *first);
+	}
+	storage.count = old_count + n;
+	return pos;
+}
+
+
+template<typename T, std::size_t Capacity>
+template<typename InputIterator, typename>
+constexpr void cx_static_vector<T, Capacity>::assign(InputIterator first, InputIterator last)
+{
+	range_assign(first, last,
+		typename std::iterator_traits<InputIterator>::iterator_category());
+}
+
+
+template<typename T, std::size_t Capacity>
+template<typename InputIterator>
+void cx_static_vector<T, Capacity>::range_assign(InputIterator first,
+	InputIterator last, std::input_iterator_tag)
+{
+	//the length is known only at last, so the elements are staged and an
+	//overflow leaves the vector as it was
+	cx_static_vector staged;
+	for (; first != last; ++first) {
+		staged.emplace_back(*first);
+	}
+	*this = std::move(staged);
+}
+
+
+template<typename T, std::size_t Capacity>
+template<typename ForwardIterator>
+constexpr void cx_static_vector<T, Capacity>::range_assign(ForwardIterator first,
+	ForwardIterator last, std::forward_iterator_tag)
+{
+	size_type n = std::distance(first, last);
+	if (n > Capacity) {
+		throw std::length_error("cx_static_vector is full");
+	}
+
+	size_type i = 0;
+	for (; i < n && i < storage.count; ++i, ++first) {
+		storage.elems[i] = *first;
+	}
+
+	if (n < storage.count) {
+		destroy_range(n, storage.count);
+		storage.count = n;
+		return;
+	}
+	for (; i < n; ++i, ++first) {
+		construct_at(i, *first);
+		storage.count = i + 1;
+	}
+}
+
+
+template<typename T, std::size_t Capacity>
+constexpr bool operator==(const cx_static_vector<T, Capacity>& lhs,
+						  const cx_static_vector<T, Capacity>& rhs)
+{
+	if (lhs.size() != rhs.size())
+		return false;
+
+	for (std::size_t i = 0; i < lhs.size(); ++i) {
+		if (lhs[i] != rhs[i])
+			return false;
+	}
+
+	return true;
+}
+
+
+template<typename T, std::size_t Capacity>
+constexpr bool operator!=(const cx_static_vector<T, Capacity>& lhs,
+						  const cx_static_vector<T, Capacity>& rhs)
+{
+	return !(lhs == rhs);
+}
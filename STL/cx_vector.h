@@ -3,10 +3,59 @@
 #include <memory>
 #include "alloc_destroy.h"
 #include <algorithm>
+#include <functional>
 #include <initializer_list>
+#include <stdexcept>
 
 
-template<typename T, typename Alloc = free_list_allocator<T>>
+namespace cx {
+	//ҪԪĬϳʼƽ͵Ԫز㣬ֵȷ
+	//	cx_vector<char> buffer(size, cx::default_init);
+	struct default_init_t
+	{
+		explicit default_init_t() = default;
+	};
+
+	constexpr default_init_t default_init{};
+}
+
+
+/*
+  ݲԣǰҪµ
+	cx_vector<int, free_list_allocator<int>, growth_1_5x> vec;
+  ֵСҪʱҪ
+*/
+struct growth_2x
+{
+	std::size_t operator()(std::size_t capacity, std::size_t required) const noexcept {
+		return std::max(capacity * 2, required);
+	}
+};
+
+//·ĴһЩеĿռ
+struct growth_1_5x
+{
+	std::size_t operator()(std::size_t capacity, std::size_t required) const noexcept {
+		return std::max(capacity + capacity / 2, required);
+	}
+};
+
+
+//еԪoperator==<>operator!=<>ҪģѾ
+template<typename T, typename Alloc = free_list_allocator<T>,
+		 typename GrowthPolicy = growth_2x>
+class cx_vector;
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+bool operator==(const cx_vector<T, Alloc, GrowthPolicy>& lhs,
+				const cx_vector<T, Alloc, GrowthPolicy>& rhs);
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+bool operator!=(const cx_vector<T, Alloc, GrowthPolicy>& lhs,
+				const cx_vector<T, Alloc, GrowthPolicy>& rhs);
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
 class cx_vector
 {
 public:
@@ -19,15 +68,70 @@ public:
 	using difference_type = std::ptrdiff_t;
 	using size_type = std::size_t;
 	using allocator_type = Alloc;
+	using growth_policy = GrowthPolicy;
 
+	//vectorһʱٷԪظ
 	static constexpr std::size_t INIT_SIZE = 16;
 
+	//ƽǨԪڷreallocateʱ:
+	//malloc_allocatorreallocmremap_allocatorԴڴmremapֽ
+	static constexpr bool REALLOCATE = alloc::is_trivially_relocatable<T>::value &&
+		alloc::has_reallocate<Alloc>::value;
+
 protected:
+	using alloc_traits = std::allocator_traits<Alloc>;
+
+	allocator_type allocator;
 	iterator start;    //Ŀǰʹÿռͷ
 	iterator finish;   //Ŀǰʹÿռβ
 	iterator end_of_storage;        //Ŀǰÿռβ
 
+	template<typename Construct>
+	void allocate_initialize(size_type n, Construct construct);
 	void fill_initialize(size_type n, const T& value);
+	void value_initialize(size_type n);
+	void default_initialize(size_type n);
+	void release_storage() noexcept;
+	void swap_storage(cx_vector& vec) noexcept;
+	size_type next_capacity(size_type required) const;
+
+	bool in_storage(const T *p) const noexcept {
+		return !std::less<const T*>()(p, start) && std::less<const T*>()(p, finish);
+	}
+	template<typename Construct>
+	iterator realloc_insert(iterator pos, size_type n, size_type new_size,
+							Construct construct);
+	template<typename Construct>
+	iterator aux_realloc_insert(iterator pos, size_type n, size_type new_size,
+								Construct construct, std::true_type);
+	template<typename Construct>
+	iterator aux_realloc_insert(iterator pos, size_type n, size_type new_size,
+								Construct construct, std::false_type);
+	void realloc_storage(size_type new_size);
+
+	//Ӧƥ(n, value)ǵ
+	template<typename InputIterator>
+	using enable_if_iterator = typename std::enable_if<
+		!std::is_integral<InputIterator>::value>::type;
+
+	template<typename InputIterator>
+	void range_initialize(InputIterator first, InputIterator last,
+						  std::input_iterator_tag);
+	template<typename ForwardIterator>
+	void range_initialize(ForwardIterator first, ForwardIterator last,
+						  std::forward_iterator_tag);
+	template<typename InputIterator>
+	iterator range_insert(iterator pos, InputIterator first, InputIterator last,
+						  std::input_iterator_tag);
+	template<typename ForwardIterator>
+	iterator range_insert(iterator pos, ForwardIterator first, ForwardIterator last,
+						  std::forward_iterator_tag);
+	template<typename InputIterator>
+	void range_assign(InputIterator first, InputIterator last,
+					  std::input_iterator_tag);
+	template<typename ForwardIterator>
+	void range_assign(ForwardIterator first, ForwardIterator last,
+					  std::forward_iterator_tag);
 	
 public:
 	iterator begin() noexcept { return start; }
@@ -37,40 +141,67 @@ public:
 
 	size_type size() const noexcept { return finish - start; }
 	size_type capacity() const noexcept { return end_of_storage - start; }
+	size_type max_size() const noexcept { return alloc_traits::max_size(allocator); }
 	bool empty() const noexcept { return start == finish; }
 	reference operator[](size_type n) { return *(start + n); }
 	const_reference operator[](size_type n) const { return *(start + n); }
 
-	cx_vector();
-	cx_vector(size_type n, const T& value) { fill_initialize(n, value); }
-	explicit cx_vector(std::initializer_list<T> list);
-	cx_vector(const cx_vector<T>& vec);
-	cx_vector(cx_vector<T>&& vec) noexcept;
-	explicit cx_vector(size_type n) { fill_initialize(n, T()); }
-	cx_vector<T, Alloc>& operator=(const cx_vector<T>& vec);
-	cx_vector<T, Alloc>& operator=(cx_vector<T>&& vec) noexcept;
-
-	void swap(cx_vector<T>& vec) noexcept;
-	template<typename U>
-	friend void swap(cx_vector<U>& ls, cx_vector<U>& rs)
+	cx_vector(): cx_vector(allocator_type()) {}
+	explicit cx_vector(const allocator_type& alloc);
+	cx_vector(size_type n, const T& value,
+			  const allocator_type& alloc = allocator_type()): allocator(alloc) {
+		fill_initialize(n, value);
+	}
+	template<typename InputIterator, typename = enable_if_iterator<InputIterator>>
+	cx_vector(InputIterator first, InputIterator last,
+			  const allocator_type& alloc = allocator_type());
+	explicit cx_vector(std::initializer_list<T> list,
+					   const allocator_type& alloc = allocator_type());
+	cx_vector(const cx_vector& vec);
+	cx_vector(const cx_vector& vec, const allocator_type& alloc);
+	cx_vector(cx_vector&& vec) noexcept;
+	cx_vector(cx_vector&& vec, const allocator_type& alloc);
+	explicit cx_vector(size_type n, const allocator_type& alloc = allocator_type()):
+		allocator(alloc) {
+		value_initialize(n);
+	}
+	cx_vector(size_type n, cx::default_init_t,
+			  const allocator_type& alloc = allocator_type()): allocator(alloc) {
+		default_initialize(n);
+	}
+	cx_vector& operator=(const cx_vector& vec);
+	cx_vector& operator=(cx_vector&& vec) noexcept(
+		alloc_traits::propagate_on_container_move_assignment::value ||
+		alloc_traits::is_always_equal::value);
+
+	allocator_type get_allocator() const noexcept { return allocator; }
+
+	void swap(cx_vector& vec) noexcept;
+	friend void swap(cx_vector& ls, cx_vector& rs) noexcept
 	{
 		ls.swap(rs);
 	}
 
-	~cx_vector() noexcept{
-		if (!start)
-			return;
-		alloc::destroy(start, finish);
-		Alloc::deallocate(start, end_of_storage - start);
-	}
+	~cx_vector() noexcept { release_storage(); }
 
 	reference front() { return *start; }
 	const_reference front() const { return *start; }
 	reference back() { return *(finish - 1); }
 	const_reference back() const { return *(finish - 1); }
 
-	void push_back(const T& val) { insert(finish, val); }
-	void push_back(T&& val) { insert(finish, std::forward<T>(val)); }
+	void reserve(size_type n);
+	void shrink_to_fit();
+	void resize(size_type n);
+	void resize(size_type n, const T& value);
+	//ԪĬϳʼᱻдĻ
+	void resize_default_init(size_type n);
+
+	void push_back(const T& val) { emplace_back(val); }
+	void push_back(T&& val) { emplace_back(std::move(val)); }
+	template<typename... Args>
+	reference emplace_back(Args&&... args);
+	template<typename... Args>
+	iterator emplace(iterator pos, Args&&... args);
 	void pop_back();
 	iterator erase(iterator pos);
 	iterator erase(iterator beg, iterator end);
@@ -78,7 +209,11 @@ public:
 
 	iterator insert(iterator pos, size_type n, const T& value);
 	iterator insert(iterator pos, const T& val) { return insert(pos, 1, val); }
-	iterator insert(iterator pos, T&& val);
+	iterator insert(iterator pos, T&& val) { return emplace(pos, std::move(val)); }
+	template<typename InputIterator, typename = enable_if_iterator<InputIterator>>
+	iterator insert(iterator pos, InputIterator first, InputIterator last);
+	template<typename InputIterator, typename = enable_if_iterator<InputIterator>>
+	void assign(InputIterator first, InputIterator last);
 
 
 	friend bool operator==<>(const cx_vector& lhs, 
@@ -89,46 +224,142 @@ public:
 };
 
 
-template<typename T, typename Alloc>
-cx_vector<T, Alloc>::cx_vector()
+//һβʱŷռ
+template<typename T, typename Alloc, typename GrowthPolicy>
+cx_vector<T, Alloc, GrowthPolicy>::cx_vector(const allocator_type& alloc): allocator(alloc)
 {
-	start = Alloc::allocate(INIT_SIZE);
-	finish = start;
-	end_of_storage = start + INIT_SIZE;
+	start = finish = end_of_storage = nullptr;
 }
 
 
-template<typename T, typename Alloc>
-void cx_vector<T, Alloc>::fill_initialize(
-			typename cx_vector<T, Alloc>::size_type n,
-			const T& value)
+//nԪصĿռ䣬construct(start)Ԫزfinish
+//캯׳쳣ʱȹ黹ռ
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename Construct>
+void cx_vector<T, Alloc, GrowthPolicy>::allocate_initialize(typename cx_vector<T, Alloc, GrowthPolicy>::size_type n,
+	Construct construct)
 {
-	start = Alloc::allocate(n);
-	finish = std::uninitialized_fill_n(start, n, value);
+	start = allocator.allocate(n);
+	try {
+		finish = construct(start);
+	}
+	catch (...) {
+		allocator.deallocate(start, n);
+		throw;
+	}
 	end_of_storage = finish;
 }
 
 
-template<typename T, typename Alloc>
-cx_vector<T, Alloc>::cx_vector(std::initializer_list<T> list)
+template<typename T, typename Alloc, typename GrowthPolicy>
+void cx_vector<T, Alloc, GrowthPolicy>::fill_initialize(
+			typename cx_vector<T, Alloc, GrowthPolicy>::size_type n,
+			const T& value)
 {
-	start = Alloc::allocate(list.size());
-	finish = std::uninitialized_move(list.begin(), list.end(), start);
-	end_of_storage = finish;
+	allocate_initialize(n, [&](iterator p) {
+		return alloc::uninitialized_fill_n(p, n, value);
+	});
 }
 
 
-template<typename T, typename Alloc>
-cx_vector<T, Alloc>::cx_vector(const cx_vector<T>& vec)
+template<typename T, typename Alloc, typename GrowthPolicy>
+void cx_vector<T, Alloc, GrowthPolicy>::value_initialize(typename cx_vector<T, Alloc, GrowthPolicy>::size_type n)
 {
-	start = Alloc::allocate(vec.size());
-	finish = std::uninitialized_copy(vec.cbegin(), vec.cend(), start);
-	end_of_storage = finish;
+	allocate_initialize(n, [&](iterator p) {
+		return alloc::uninitialized_value_construct_n(p, n);
+	});
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+void cx_vector<T, Alloc, GrowthPolicy>::default_initialize(typename cx_vector<T, Alloc, GrowthPolicy>::size_type n)
+{
+	allocate_initialize(n, [&](iterator p) {
+		return alloc::uninitialized_default_construct_n(p, n);
+	});
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+void cx_vector<T, Alloc, GrowthPolicy>::release_storage() noexcept
+{
+	if (!start)
+		return;
+	alloc::destroy(start, finish);
+	allocator.deallocate(start, end_of_storage - start);
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+cx_vector<T, Alloc, GrowthPolicy>::cx_vector(std::initializer_list<T> list,
+							   const allocator_type& alloc): allocator(alloc)
+{
+	allocate_initialize(list.size(), [&](iterator p) {
+		return alloc::uninitialized_copy(list.begin(), list.end(), p);
+	});
+}
+
+
+//ǰԪظֻһ
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename InputIterator, typename>
+cx_vector<T, Alloc, GrowthPolicy>::cx_vector(InputIterator first, InputIterator last,
+	const allocator_type& alloc): allocator(alloc)
+{
+	start = finish = end_of_storage = nullptr;
+	range_initialize(first, last,
+		typename std::iterator_traits<InputIterator>::iterator_category());
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename InputIterator>
+void cx_vector<T, Alloc, GrowthPolicy>::range_initialize(InputIterator first, InputIterator last,
+	std::input_iterator_tag)
+{
+	try {
+		for (; first != last; ++first) {
+			emplace_back(*first);
+		}
+	}
+	catch (...) {
+		release_storage();
+		throw;
+	}
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename ForwardIterator>
+void cx_vector<T, Alloc, GrowthPolicy>::range_initialize(ForwardIterator first, ForwardIterator last,
+	std::forward_iterator_tag)
+{
+	size_type n = std::distance(first, last);
+	allocate_initialize(n, [&](iterator p) {
+		return alloc::uninitialized_copy(first, last, p);
+	});
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+cx_vector<T, Alloc, GrowthPolicy>::cx_vector(const cx_vector& vec):
+	cx_vector(vec,
+		alloc_traits::select_on_container_copy_construction(vec.allocator)) {}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+cx_vector<T, Alloc, GrowthPolicy>::cx_vector(const cx_vector& vec, const allocator_type& alloc):
+	allocator(alloc)
+{
+	allocate_initialize(vec.size(), [&](iterator p) {
+		return alloc::uninitialized_copy(vec.cbegin(), vec.cend(), p);
+	});
 }
 
 
-template<typename T, typename Alloc>
-cx_vector<T, Alloc>::cx_vector(cx_vector<T>&& vec) noexcept
+template<typename T, typename Alloc, typename GrowthPolicy>
+cx_vector<T, Alloc, GrowthPolicy>::cx_vector(cx_vector&& vec) noexcept:
+	allocator(std::move(vec.allocator))
 {
 	start = vec.start;
 	finish = vec.finish;
@@ -140,8 +371,30 @@ cx_vector<T, Alloc>::cx_vector(cx_vector<T>&& vec) noexcept
 }
 
 
-template<typename T, typename Alloc>
-void cx_vector<T, Alloc>::swap(cx_vector<T>& vec) noexcept
+template<typename T, typename Alloc, typename GrowthPolicy>
+cx_vector<T, Alloc, GrowthPolicy>::cx_vector(cx_vector&& vec, const allocator_type& alloc):
+	allocator(alloc)
+{
+	if (allocator == vec.allocator) {
+		start = vec.start;
+		finish = vec.finish;
+		end_of_storage = vec.end_of_storage;
+
+		vec.start = nullptr;
+		vec.finish = nullptr;
+		vec.end_of_storage = nullptr;
+	}
+	else {
+		//һڴ治ܽӹܣֻƶԪ
+		allocate_initialize(vec.size(), [&](iterator p) {
+			return alloc::uninitialized_move(vec.start, vec.finish, p);
+		});
+	}
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+void cx_vector<T, Alloc, GrowthPolicy>::swap_storage(cx_vector& vec) noexcept
 {
 	using std::swap;
 	swap(start, vec.start);
@@ -150,49 +403,86 @@ void cx_vector<T, Alloc>::swap(cx_vector<T>& vec) noexcept
 }
 
 
-template<typename T, typename Alloc>
-cx_vector<T, Alloc>& 
-cx_vector<T, Alloc>::operator=(const cx_vector<T>& vec)
+template<typename T, typename Alloc, typename GrowthPolicy>
+void cx_vector<T, Alloc, GrowthPolicy>::swap(cx_vector& vec) noexcept
+{
+	if (alloc_traits::propagate_on_container_swap::value) {
+		using std::swap;
+		swap(allocator, vec.allocator);
+	}
+	swap_storage(vec);
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+cx_vector<T, Alloc, GrowthPolicy>& 
+cx_vector<T, Alloc, GrowthPolicy>::operator=(const cx_vector& vec)
 {
-	cx_vector<T, Alloc> new_vec(vec);
-	swap(new_vec);
+	if (this == &vec)
+		return *this;
+
+	if (alloc_traits::propagate_on_container_copy_assignment::value) {
+		//ɿռɾɵķ黹
+		if (allocator != vec.allocator) {
+			release_storage();
+			start = finish = end_of_storage = nullptr;
+		}
+		allocator = vec.allocator;
+	}
+
+	cx_vector new_vec(vec, allocator);
+	swap_storage(new_vec);
 	return *this;
 }
 
-template<typename T, typename Alloc>
-cx_vector<T, Alloc>&
-cx_vector<T, Alloc>::operator=(cx_vector<T>&& vec) noexcept
+template<typename T, typename Alloc, typename GrowthPolicy>
+cx_vector<T, Alloc, GrowthPolicy>&
+cx_vector<T, Alloc, GrowthPolicy>::operator=(cx_vector&& vec) noexcept(
+	alloc_traits::propagate_on_container_move_assignment::value ||
+	alloc_traits::is_always_equal::value)
 {
-	swap(vec);
+	if (alloc_traits::propagate_on_container_move_assignment::value) {
+		//ɿռһ𽻸vecͷ
+		using std::swap;
+		swap(allocator, vec.allocator);
+		swap_storage(vec);
+	}
+	else if (allocator == vec.allocator) {
+		swap_storage(vec);
+	}
+	else {
+		cx_vector new_vec(std::move(vec), allocator);
+		swap_storage(new_vec);
+	}
 	return *this;
 }
 
 
-template<typename T, typename Alloc>
-void cx_vector<T, Alloc>::pop_back()
+template<typename T, typename Alloc, typename GrowthPolicy>
+void cx_vector<T, Alloc, GrowthPolicy>::pop_back()
 {
 	--finish;
 	alloc::destroy(finish);
 }
 
 
-template<typename T, typename Alloc>
-typename cx_vector<T, Alloc>::iterator
-cx_vector<T, Alloc>::erase(typename cx_vector<T, Alloc>::iterator pos)
+template<typename T, typename Alloc, typename GrowthPolicy>
+typename cx_vector<T, Alloc, GrowthPolicy>::iterator
+cx_vector<T, Alloc, GrowthPolicy>::erase(typename cx_vector<T, Alloc, GrowthPolicy>::iterator pos)
 {
 	return erase(pos, pos + 1);
 }
 
 
 
-template<typename T, typename Alloc>
-typename cx_vector<T, Alloc>::iterator
-cx_vector<T, Alloc>::erase(typename cx_vector<T, Alloc>::iterator beg,
-						   typename cx_vector<T, Alloc>::iterator end)
+template<typename T, typename Alloc, typename GrowthPolicy>
+typename cx_vector<T, Alloc, GrowthPolicy>::iterator
+cx_vector<T, Alloc, GrowthPolicy>::erase(typename cx_vector<T, Alloc, GrowthPolicy>::iterator beg,
+						   typename cx_vector<T, Alloc, GrowthPolicy>::iterator end)
 {
 	if (end != finish)
 	{
-		std::move(end, finish, beg);
+		alloc::move(end, finish, beg);
 	}
 
 	alloc::destroy(finish - end + beg, finish);
@@ -201,90 +491,413 @@ cx_vector<T, Alloc>::erase(typename cx_vector<T, Alloc>::iterator beg,
 }
  
 
-template<typename T, typename Alloc>
-typename cx_vector<T, Alloc>::iterator
-cx_vector<T, Alloc>::insert(typename cx_vector<T, Alloc>::iterator pos,
-							typename cx_vector<T, Alloc>::size_type n,
+template<typename T, typename Alloc, typename GrowthPolicy>
+typename cx_vector<T, Alloc, GrowthPolicy>::iterator
+cx_vector<T, Alloc, GrowthPolicy>::insert(typename cx_vector<T, Alloc, GrowthPolicy>::iterator pos,
+							typename cx_vector<T, Alloc, GrowthPolicy>::size_type n,
 							const T& value)
 {
 	if (end_of_storage - finish >= n)
 	{
+		//valueҪƶԪ
+		T copy(value);
 		size_type elem_after = finish - pos;
 
 		if (elem_after > n) {
-			std::uninitialized_move(finish - n, finish, finish);
-			std::move_backward(pos, finish - n, finish);
-			std::fill_n(pos, n, value);
+			alloc::uninitialized_move(finish - n, finish, finish);
+			alloc::move_backward(pos, finish - n, finish);
+			std::fill_n(pos, n, copy);
 			finish += n;
 		}
 		else {
 			iterator old_finish = finish;
-			finish = std::uninitialized_fill_n(finish, n - elem_after, value);
-			finish = std::uninitialized_move(pos, old_finish, finish);
-			std::fill_n(pos, elem_after, value);
+			finish = alloc::uninitialized_fill_n(finish, n - elem_after, copy);
+			finish = alloc::uninitialized_move(pos, old_finish, finish);
+			std::fill_n(pos, elem_after, copy);
 		}
 	}
 	else
 	{
-		size_type old_size = size();
-		size_type new_size = old_size + std::max(old_size, n);
-
-		iterator new_start = Alloc::allocate(new_size);
-		iterator new_finish = std::uninitialized_move(start, pos, new_start);
-		new_finish = std::uninitialized_fill_n(new_finish, n, value);
-		new_finish = std::uninitialized_move(pos, finish, new_finish);
-		
-		alloc::destroy(start, finish);
-		Alloc::deallocate(start, old_size);
-
-		start = new_start;
-		finish = new_finish;
-		end_of_storage = start + new_size;
+		//reallocateͷžɿռ䣬valueܾǾɿռԪ
+		if (REALLOCATE && in_storage(&value)) {
+			T copy(value);
+			return insert(pos, n, copy);
+		}
+
+		pos = realloc_insert(pos, n, next_capacity(size() + n), [&](iterator gap) {
+			alloc::uninitialized_fill_n(gap, n, value);
+		});
 	}
 
 	return pos;
 }
 
 
-template<typename T, typename Alloc>
-typename cx_vector<T, Alloc>::iterator
-cx_vector<T, Alloc>::insert(typename cx_vector<T, Alloc>::iterator pos, T&& val)
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename... Args>
+typename cx_vector<T, Alloc, GrowthPolicy>::reference
+cx_vector<T, Alloc, GrowthPolicy>::emplace_back(Args&&... args)
+{
+	if (finish != end_of_storage) {
+		alloc::construct(finish, std::forward<Args>(args)...);
+		++finish;
+	}
+	else {
+		emplace(finish, std::forward<Args>(args)...);
+	}
+	return back();
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename... Args>
+typename cx_vector<T, Alloc, GrowthPolicy>::iterator
+cx_vector<T, Alloc, GrowthPolicy>::emplace(typename cx_vector<T, Alloc, GrowthPolicy>::iterator pos,
+	Args&&... args)
 {
-	if (end_of_storage - finish >= 1)
+	if (finish != end_of_storage)
 	{
-		if (pos != finish) {
-			std::uninitialized_move(finish - 1, finish, finish);
-			std::move_backward(pos, finish - 1, finish);
+		if (pos == finish) {
+			alloc::construct(finish, std::forward<Args>(args)...);
+		}
+		else {
+			//argsҪƵԪأȹ
+			T tmp(std::forward<Args>(args)...);
+			alloc::construct(finish, std::move(*(finish - 1)));
+			alloc::move_backward(pos, finish - 1, finish);
+			*pos = std::move(tmp);
 		}
-		alloc::construct(pos, std::forward<T>(val));
-		finish += 1;
+		++finish;
+		return pos;
 	}
-	else
+
+	if (REALLOCATE) {
+		//reallocateͷžɿռ䣬argsеԪ
+		T tmp(std::forward<Args>(args)...);
+		return realloc_insert(pos, 1, next_capacity(size() + 1), [&](iterator gap) {
+			alloc::construct(gap, std::move(tmp));
+		});
+	}
+
+	return realloc_insert(pos, 1, next_capacity(size() + 1), [&](iterator gap) {
+		alloc::construct(gap, std::forward<Args>(args)...);
+	});
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+void cx_vector<T, Alloc, GrowthPolicy>::reserve(typename cx_vector<T, Alloc, GrowthPolicy>::size_type n)
+{
+	if (n > max_size()) {
+		throw std::length_error("cx_vector::reserve");
+	}
+	if (n > capacity()) {
+		realloc_storage(n);
+	}
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+void cx_vector<T, Alloc, GrowthPolicy>::shrink_to_fit()
+{
+	if (finish == end_of_storage) {
+		return;
+	}
+
+	if (start == finish) {
+		release_storage();
+		start = finish = end_of_storage = nullptr;
+		return;
+	}
+	realloc_storage(size());
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+void cx_vector<T, Alloc, GrowthPolicy>::resize(typename cx_vector<T, Alloc, GrowthPolicy>::size_type n)
+{
+	if (n <= size()) {
+		erase(start + n, finish);
+		return;
+	}
+
+	if (n > capacity()) {
+		realloc_storage(next_capacity(n));
+	}
+	finish = alloc::uninitialized_value_construct_n(finish, n - size());
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+void cx_vector<T, Alloc, GrowthPolicy>::resize_default_init(typename cx_vector<T, Alloc, GrowthPolicy>::size_type n)
+{
+	if (n <= size()) {
+		erase(start + n, finish);
+		return;
+	}
+
+	if (n > capacity()) {
+		realloc_storage(next_capacity(n));
+	}
+	finish = alloc::uninitialized_default_construct_n(finish, n - size());
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+void cx_vector<T, Alloc, GrowthPolicy>::resize(typename cx_vector<T, Alloc, GrowthPolicy>::size_type n, const T& value)
+{
+	if (n <= size()) {
+		erase(start + n, finish);
+		return;
+	}
+
+	if (n > capacity()) {
+		//valueھɿռ
+		if (in_storage(&value)) {
+			T copy(value);
+			resize(n, copy);
+			return;
+		}
+		realloc_storage(next_capacity(n));
+	}
+	finish = alloc::uninitialized_fill_n(finish, n - size(), value);
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename InputIterator, typename>
+typename cx_vector<T, Alloc, GrowthPolicy>::iterator
+cx_vector<T, Alloc, GrowthPolicy>::insert(typename cx_vector<T, Alloc, GrowthPolicy>::iterator pos,
+	InputIterator first, InputIterator last)
+{
+	return range_insert(pos, first, last,
+		typename std::iterator_traits<InputIterator>::iterator_category());
+}
+
+
+//δ֪ӵβתpos
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename InputIterator>
+typename cx_vector<T, Alloc, GrowthPolicy>::iterator
+cx_vector<T, Alloc, GrowthPolicy>::range_insert(typename cx_vector<T, Alloc, GrowthPolicy>::iterator pos,
+	InputIterator first, InputIterator last, std::input_iterator_tag)
+{
+	size_type offset = pos - start;
+	size_type old_size = size();
+	for (; first != last; ++first) {
+		emplace_back(*first);
+	}
+
+	std::rotate(start + offset, start + old_size, finish);
+	return start + offset;
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename ForwardIterator>
+typename cx_vector<T, Alloc, GrowthPolicy>::iterator
+cx_vector<T, Alloc, GrowthPolicy>::range_insert(typename cx_vector<T, Alloc, GrowthPolicy>::iterator pos,
+	ForwardIterator first, ForwardIterator last, std::forward_iterator_tag)
+{
+	size_type n = std::distance(first, last);
+	if (n == 0) {
+		return pos;
+	}
+
+	if (size_type(end_of_storage - finish) >= n)
 	{
-		size_type old_size = size();
-		size_type new_size = old_size * 2;
+		size_type elem_after = finish - pos;
+		iterator old_finish = finish;
 
-		iterator new_start = Alloc::allocate(new_size);
-		iterator new_finish = std::uninitialized_move(start, pos, new_start);
-		alloc::construct(new_finish, std::forward<T>(val));
-		new_finish += 1;
-		new_finish = std::uninitialized_move(pos, finish, new_finish);
+		if (elem_after > n) {
+			finish = alloc::uninitialized_move(finish - n, finish, finish);
+			alloc::move_backward(pos, old_finish - n, old_finish);
+			alloc::copy(first, last, pos);
+		}
+		else {
+			ForwardIterator mid = first;
+			std::advance(mid, elem_after);
+			finish = alloc::uninitialized_copy(mid, last, finish);
+			finish = alloc::uninitialized_move(pos, old_finish, finish);
+			alloc::copy(first, mid, pos);
+		}
+		return pos;
+	}
+
+	return realloc_insert(pos, n, next_capacity(size() + n), [&](iterator gap) {
+		alloc::uninitialized_copy(first, last, gap);
+	});
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename InputIterator, typename>
+void cx_vector<T, Alloc, GrowthPolicy>::assign(InputIterator first, InputIterator last)
+{
+	range_assign(first, last,
+		typename std::iterator_traits<InputIterator>::iterator_category());
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename InputIterator>
+void cx_vector<T, Alloc, GrowthPolicy>::range_assign(InputIterator first, InputIterator last,
+	std::input_iterator_tag)
+{
+	iterator cur = start;
+	for (; first != last && cur != finish; ++first, ++cur) {
+		*cur = *first;
+	}
+
+	if (first == last) {
+		erase(cur, finish);
+		return;
+	}
+	for (; first != last; ++first) {
+		emplace_back(*first);
+	}
+}
 
-		alloc::destroy(start, finish);
-		Alloc::deallocate(start, old_size);
 
-		start = new_start;
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename ForwardIterator>
+void cx_vector<T, Alloc, GrowthPolicy>::range_assign(ForwardIterator first, ForwardIterator last,
+	std::forward_iterator_tag)
+{
+	size_type n = std::distance(first, last);
+	if (n > capacity()) {
+		//Ԫزرֱӻ¿ռ
+		cx_vector new_vec(first, last, allocator);
+		swap_storage(new_vec);
+		return;
+	}
+
+	if (n <= size()) {
+		iterator new_finish = alloc::copy(first, last, start);
+		alloc::destroy(new_finish, finish);
 		finish = new_finish;
-		end_of_storage = start + new_size;
 	}
+	else {
+		ForwardIterator mid = first;
+		std::advance(mid, size());
+		alloc::copy(first, mid, start);
+		finish = alloc::uninitialized_copy(mid, last, finish);
+	}
+}
 
-	return pos;
+
+//ܷrequiredԪص
+template<typename T, typename Alloc, typename GrowthPolicy>
+typename cx_vector<T, Alloc, GrowthPolicy>::size_type
+cx_vector<T, Alloc, GrowthPolicy>::next_capacity(typename cx_vector<T, Alloc, GrowthPolicy>::size_type required) const
+{
+	if (required > max_size()) {
+		throw std::length_error("cx_vector is too long");
+	}
+
+	size_type result = capacity() == 0 ?
+		INIT_SIZE : growth_policy()(capacity(), required);
+	return std::min(std::max(result, required), max_size());
+}
+
+
+//Ϊnew_sizeСsize()
+template<typename T, typename Alloc, typename GrowthPolicy>
+void cx_vector<T, Alloc, GrowthPolicy>::realloc_storage(typename cx_vector<T, Alloc, GrowthPolicy>::size_type new_size)
+{
+	realloc_insert(finish, 0, new_size, [](iterator) {});
+}
+
+
+//new_sizeĿռ䣬posnλconstruct죬µpos
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename Construct>
+typename cx_vector<T, Alloc, GrowthPolicy>::iterator
+cx_vector<T, Alloc, GrowthPolicy>::realloc_insert(typename cx_vector<T, Alloc, GrowthPolicy>::iterator pos,
+								 typename cx_vector<T, Alloc, GrowthPolicy>::size_type n,
+								 typename cx_vector<T, Alloc, GrowthPolicy>::size_type new_size,
+								 Construct construct)
+{
+	return aux_realloc_insert(pos, n, new_size, construct,
+						   std::integral_constant<bool, REALLOCATE>());
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename Construct>
+typename cx_vector<T, Alloc, GrowthPolicy>::iterator
+cx_vector<T, Alloc, GrowthPolicy>::aux_realloc_insert(typename cx_vector<T, Alloc, GrowthPolicy>::iterator pos,
+									 typename cx_vector<T, Alloc, GrowthPolicy>::size_type n,
+									 typename cx_vector<T, Alloc, GrowthPolicy>::size_type new_size,
+									 Construct construct, std::true_type)
+{
+	size_type offset = pos - start;
+	size_type old_size = size();
+
+	//ԪֽռߣٰposԪغ
+	start = allocator.reallocate(start, capacity(), new_size);
+	finish = start + old_size;
+	end_of_storage = start + new_size;
+
+	iterator gap = start + offset;
+	alloc::move_bytes(gap, finish, gap + n);
+	try {
+		construct(gap);
+	}
+	catch (...) {
+		alloc::move_bytes(gap + n, finish + n, gap);
+		throw;
+	}
+
+	finish += n;
+	return gap;
+}
+
+
+template<typename T, typename Alloc, typename GrowthPolicy>
+template<typename Construct>
+typename cx_vector<T, Alloc, GrowthPolicy>::iterator
+cx_vector<T, Alloc, GrowthPolicy>::aux_realloc_insert(typename cx_vector<T, Alloc, GrowthPolicy>::iterator pos,
+									 typename cx_vector<T, Alloc, GrowthPolicy>::size_type n,
+									 typename cx_vector<T, Alloc, GrowthPolicy>::size_type new_size,
+									 Construct construct, std::false_type)
+{
+	iterator new_start = allocator.allocate(new_size);
+	iterator new_pos = new_start + (pos - start);
+	//ȹԪأԾɿռԪ
+	try {
+		construct(new_pos);
+	}
+	catch (...) {
+		allocator.deallocate(new_start, new_size);
+		throw;
+	}
+
+	//Ԫذᵽ¿ռɿռûж󣬿ƽǨʱֻһmemmove
+	//Ǩ׳쳣ʱԪرԭԪغ¿ռ䶼Ҫͷ
+	iterator new_finish;
+	try {
+		new_finish = alloc::uninitialized_relocate_gap(start, pos, finish, new_start, n);
+	}
+	catch (...) {
+		alloc::destroy(new_pos, new_pos + n);
+		allocator.deallocate(new_start, new_size);
+		throw;
+	}
+	if (start) {
+		allocator.deallocate(start, capacity());
+	}
+
+	start = new_start;
+	finish = new_finish;
+	end_of_storage = start + new_size;
+	return new_pos;
 }
 
 
-template<typename T, typename Alloc>
-bool operator==(const cx_vector<T, Alloc>& lhs, 
-				const cx_vector<T, Alloc>& rhs)
+template<typename T, typename Alloc, typename GrowthPolicy>
+bool operator==(const cx_vector<T, Alloc, GrowthPolicy>& lhs, 
+				const cx_vector<T, Alloc, GrowthPolicy>& rhs)
 {
 	if (lhs.size() != rhs.size())
 		return false;
@@ -298,9 +911,9 @@ bool operator==(const cx_vector<T, Alloc>& lhs,
 }
 
 
-template<typename T, typename Alloc>
-bool operator!=(const cx_vector<T, Alloc>& lhs,
-				const cx_vector<T, Alloc>& rhs)
+template<typename T, typename Alloc, typename GrowthPolicy>
+bool operator!=(const cx_vector<T, Alloc, GrowthPolicy>& lhs,
+				const cx_vector<T, Alloc, GrowthPolicy>& rhs)
 {
 	return !(lhs == rhs);
 }
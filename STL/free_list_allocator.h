@@ -1,46 +1,216 @@
 #pragma once
 #include "malloc_allocator.h"
+#include "size_class.h"
+#include "chunk_source.h"
+#include "alloc_stats.h"
+#include "alloc_trace.h"
+#include "heap_profile.h"
 #include <iostream>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstdint>
 
 
-template<typename T>
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+
+template<typename T, typename SizeClass = geometric_size_classes<>,
+		 typename ChunkSource = malloc_chunk_source>
 class free_list_allocator
 {
+	static_assert(verify_size_classes<SizeClass>(),
+				  "SizeClass does not map sizes onto its classes");
+
 private:
-	static constexpr std::size_t ALIGN = 8;
-	static constexpr std::size_t MAX_BLOCK_SIZE = 128;
-	static constexpr std::size_t FREE_LIST_NUM = MAX_BLOCK_SIZE / ALIGN;
+	static constexpr std::size_t ALIGN = SizeClass::ALIGN;
+	static constexpr std::size_t MAX_BLOCK_SIZE = SizeClass::MAX_BLOCK_SIZE;
+	static constexpr std::size_t FREE_LIST_NUM = SizeClass::CLASS_NUM;
+	//Ķ룬ALIGNʱֻʹôСΪ
+	static constexpr std::size_t BLOCK_ALIGN =
+		alignof(T) > ALIGN ? alignof(T) : ALIGN;
+	//ûʱȫChunkSource
+	static constexpr bool POOLED = BLOCK_ALIGN <= MAX_BLOCK_SIZE &&
+		MAX_BLOCK_SIZE % BLOCK_ALIGN == 0;
+	//chunkĴСÿchunkCHUNK_SIZE룬ɿֱַchunk
+	//ҳChunkSourceһchunkռһҳ
+	static constexpr std::size_t CHUNK_SIZE =
+		ChunkSource::PAGE_BYTES > 64 * 1024 ? ChunkSource::PAGE_BYTES : 64 * 1024;
 
 	struct obj
 	{
 		obj *free_list_link;
 	};
 
-	static obj *free_list[FREE_LIST_NUM];
-	//ڴʼλ
-	static char *start_pool;
-	//ڴؽλ
-	static char *end_pool;
+	struct thread_cache;
+
+	/*
+	  header at the start of every chunk. A chunk is carved into blocks of
+	  one size class and belongs to the thread_cache that requested it;
+	  only the owner touches the fields below.
+	*/
+	struct chunk
+	{
+		thread_cache *owner;
+		chunk *prev;        //owneravailablefree_chunksе
+		chunk *next;
+		chunk *pool_prev;   //ĳصǼǵchunk
+		chunk *pool_next;
+		obj *free_list;
+		//ڴʼλ
+		char *start_pool;
+		//ڴؽλ
+		char *end_pool;
+		std::size_t index;
+		std::size_t block_size;
+		std::size_t used;   //ѷȥĿ
+		bool full;
+	};
+
+	//CX_ALLOC_STATSʱÿsize classļ
+	struct class_counters
+	{
+		alloc_stats::local_counter allocate;
+		alloc_stats::local_counter deallocate;
+		alloc_stats::local_counter refill;
+		alloc_stats::local_counter chunk_alloc;
+		alloc_stats::local_counter chunks;
+	};
+
+	struct large_counters
+	{
+		alloc_stats::shared_counter allocate;
+		alloc_stats::shared_counter deallocate;
+		alloc_stats::shared_counter bytes;
+	};
+
+	/*
+	  per-thread cache for every size class. Blocks freed by another thread
+	  are pushed to remote_free and collected by the owner in refill.
+	*/
+	struct thread_cache
+	{
+		chunk *current[FREE_LIST_NUM];
+		chunk *available[FREE_LIST_NUM];   //ппchunk
+		std::atomic<obj*> remote_free[FREE_LIST_NUM];
+		std::atomic<std::size_t> used_bytes;   //ֻ߳д
+		class_counters stats[FREE_LIST_NUM];
+		thread_cache *next;
+		bool retired;       //߳˳ɱ߳̽ӹ
+	};
+
+	struct cache_handle
+	{
+		thread_cache *cache = nullptr;
+
+		~cache_handle() noexcept;
+		thread_cache *get();
+	};
+
+	//̨ڵtrim߳
+	struct trimmer
+	{
+		std::mutex trim_mutex;
+		std::condition_variable trim_cond;
+		std::thread trim_thread;
+		bool stop = false;
+
+		~trimmer() { stop_background_trim(); }
+	};
+
+	static std::mutex pool_mutex;
+	//еchunkpool_mutex
+	static chunk *free_chunks;
+	//ĳسеchunk
+	static chunk *chunks;
+	static std::size_t chunk_num;
+	static thread_cache *caches;
+	//ۼϵͳֽ
 	static std::size_t heap_size;
+	static thread_local cache_handle local_cache;
+	static trimmer background;
+	static large_counters large_stats;
 
 
-	//byteϵ8ı
+	//byteϵBLOCK_ALIGNı
 	static std::size_t round_up(std::size_t byte) noexcept
 	{
-		return ((byte) + ALIGN - 1) & ~(ALIGN - 1);
+		return ((byte) + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
 	}
 
 	//ڴСfree_list
 	static std::size_t free_list_index(std::size_t byte) noexcept
 	{
-		return  byte / (ALIGN + 1);
+		std::size_t index = SizeClass::index(byte);
+		while (BLOCK_ALIGN > ALIGN && SizeClass::size(index) % BLOCK_ALIGN != 0) {
+			++index;
+		}
+		return index;
+	}
+
+	static std::size_t class_size(std::size_t index) noexcept
+	{
+		return SizeClass::size(index);
+	}
+
+	static chunk *chunk_of(void *p) noexcept
+	{
+		return reinterpret_cast<chunk*>(
+			reinterpret_cast<std::uintptr_t>(p) & ~(CHUNK_SIZE - 1));
+	}
+
+	//MAX_BLOCK_SIZEĿֱChunkSource
+	static T *large_allocate(std::size_t num)
+	{
+		T *result = static_cast<T*>(ChunkSource::allocate(num * sizeof(T), alignof(T)));
+		large_stats.allocate.add();
+		large_stats.bytes.add(num * sizeof(T));
+		return result;
+	}
+
+	static void large_deallocate(T *p, std::size_t num) noexcept
+	{
+		ChunkSource::deallocate(p, num * sizeof(T), alignof(T));
+		large_stats.deallocate.add();
+		large_stats.bytes.sub(num * sizeof(T));
 	}
 
-	//Ϊfree_listµĿ
-	static T *refill(std::size_t block_size);
+	//һchunkгindexĿ
+	static std::size_t chunk_capacity(std::size_t index) noexcept
+	{
+		return (CHUNK_SIZE - round_up(sizeof(chunk))) / class_size(index);
+	}
+
+	static void count_used(thread_cache *cache, std::size_t add,
+						   std::size_t sub) noexcept
+	{
+		std::size_t bytes = cache->used_bytes.load(std::memory_order_relaxed);
+		cache->used_bytes.store(bytes + add - sub, std::memory_order_relaxed);
+	}
 
-	// num  block_size Ŀռ
-	static char *chunk_alloc(std::size_t block_size, std::size_t& num);
+	static T *aux_allocate(std::size_t num);
+	static void aux_allocate_batch(std::size_t num, T **result);
+	static obj *take_block(thread_cache *cache, chunk *c) noexcept;
+
+	//ǰchunkþʱȡµĿ
+	static T *refill(thread_cache *cache, std::size_t index);
+
+	//ĳȡһchunk
+	static chunk *chunk_alloc(thread_cache *cache, std::size_t index);
+	//յchunk黹ĳ
+	static void chunk_free(chunk *c) noexcept;
+
+	static void free_local(thread_cache *cache, chunk *c, obj *block) noexcept;
+	static void free_remote(thread_cache *owner, std::size_t index,
+							obj *block) noexcept;
+	static void collect_remote(thread_cache *cache, std::size_t index) noexcept;
+	//cacheпյchunk
+	static void release_empty(thread_cache *cache) noexcept;
+
+	static void link_available(thread_cache *cache, chunk *c) noexcept;
+	static void unlink_available(thread_cache *cache, chunk *c) noexcept;
 
 
 public:
@@ -48,198 +218,763 @@ public:
 
 	free_list_allocator() {}
 	template<typename U>
-	free_list_allocator(const free_list_allocator<U>&) {}
+	free_list_allocator(const free_list_allocator<U, SizeClass, ChunkSource>&) {}
 
 	static T *allocate(std::size_t num);
 	static void deallocate(T *p, std::size_t num) noexcept;
-};
 
+	//numTĿ飬ӵǰchunkһгһ
+	static void allocate_batch(std::size_t num, T **result);
+	static void deallocate_batch(T **p, std::size_t num) noexcept;
 
-template<typename T>
-typename free_list_allocator<T>::obj *
-free_list_allocator<T>::free_list[FREE_LIST_NUM] = {
-	0,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0
+	//յchunk黹ϵͳͷŵֽ
+	static std::size_t trim() noexcept;
+	static void start_background_trim(std::chrono::milliseconds period);
+	static void stop_background_trim();
+
+	static std::size_t get_heap_size() noexcept;
+	static std::size_t reserved_bytes() noexcept;
+	static std::size_t used_bytes() noexcept;
+	//ĿգֻڶCX_ALLOC_STATSʱ¼
+	static allocator_stats stats();
 };
 
 
-template<typename T>
-char *free_list_allocator<T>::start_pool = nullptr;
+template<typename T, typename SizeClass, typename ChunkSource>
+std::mutex free_list_allocator<T, SizeClass, ChunkSource>::pool_mutex;
 
-template<typename T>
-char *free_list_allocator<T>::end_pool = nullptr;
+template<typename T, typename SizeClass, typename ChunkSource>
+typename free_list_allocator<T, SizeClass, ChunkSource>::chunk *
+free_list_allocator<T, SizeClass, ChunkSource>::free_chunks = nullptr;
 
-template<typename T>
-std::size_t free_list_allocator<T>::heap_size = 0;
+template<typename T, typename SizeClass, typename ChunkSource>
+typename free_list_allocator<T, SizeClass, ChunkSource>::chunk *
+free_list_allocator<T, SizeClass, ChunkSource>::chunks = nullptr;
 
+template<typename T, typename SizeClass, typename ChunkSource>
+std::size_t free_list_allocator<T, SizeClass, ChunkSource>::chunk_num = 0;
 
-template<typename T>
-T *free_list_allocator<T>::allocate(std::size_t num)
-{	
-	if (num * sizeof(T) > MAX_BLOCK_SIZE) {
-		return malloc_allocator<T>::allocate(num);
-	}
+template<typename T, typename SizeClass, typename ChunkSource>
+typename free_list_allocator<T, SizeClass, ChunkSource>::thread_cache *
+free_list_allocator<T, SizeClass, ChunkSource>::caches = nullptr;
 
-	obj *result;
-	auto target_free_list = free_list + free_list_index(num * sizeof(T));
-	result = *target_free_list;
-	
-	if (result == nullptr) {
-		return refill(round_up(num * sizeof(T)));
+template<typename T, typename SizeClass, typename ChunkSource>
+std::size_t free_list_allocator<T, SizeClass, ChunkSource>::heap_size = 0;
+
+template<typename T, typename SizeClass, typename ChunkSource>
+thread_local typename free_list_allocator<T, SizeClass, ChunkSource>::cache_handle
+free_list_allocator<T, SizeClass, ChunkSource>::local_cache;
+
+template<typename T, typename SizeClass, typename ChunkSource>
+typename free_list_allocator<T, SizeClass, ChunkSource>::trimmer free_list_allocator<T, SizeClass, ChunkSource>::background;
+
+template<typename T, typename SizeClass, typename ChunkSource>
+typename free_list_allocator<T, SizeClass, ChunkSource>::large_counters
+free_list_allocator<T, SizeClass, ChunkSource>::large_stats;
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+T *free_list_allocator<T, SizeClass, ChunkSource>::allocate(std::size_t num)
+{
+	T *result = aux_allocate(num);
+	alloc_trace::on_allocate(result, num * sizeof(T));
+	heap_profile::on_allocate<T>(result, num * sizeof(T));
+	return result;
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+T *free_list_allocator<T, SizeClass, ChunkSource>::aux_allocate(std::size_t num)
+{
+	if (!POOLED || num * sizeof(T) > MAX_BLOCK_SIZE) {
+		return large_allocate(num);
 	}
 
+	thread_cache *cache = local_cache.get();
+	std::size_t index = free_list_index(num * sizeof(T));
+	chunk *current = cache->current[index];
+
 	//free_listڵԪָ2ڴ
-	*target_free_list = result->free_list_link;
-	return reinterpret_cast<T*>(result);
+	if (current != nullptr && current->free_list != nullptr) {
+		obj *result = current->free_list;
+		current->free_list = result->free_list_link;
+		++current->used;
+		count_used(cache, current->block_size, 0);
+		cache->stats[index].allocate.add();
+		return reinterpret_cast<T*>(result);
+	}
+
+	return refill(cache, index);
 }
 
 
-template<typename T>
-void free_list_allocator<T>::deallocate(T *p, std::size_t num) noexcept
+template<typename T, typename SizeClass, typename ChunkSource>
+void free_list_allocator<T, SizeClass, ChunkSource>::deallocate(T *p, std::size_t num) noexcept
 {
 	/*
-      pΪҪյڴָ룬numԪصĸ
+      pΪҪյڴָ룬numڴԪصĸ
 	*/
 
 	std::size_t size = num * sizeof(T);
-	if (size > MAX_BLOCK_SIZE) {
-		malloc_allocator<T>::deallocate(p, num);
+	alloc_trace::on_deallocate(p, size);
+	heap_profile::on_deallocate(p);
+	if (!POOLED || size > MAX_BLOCK_SIZE) {
+		large_deallocate(p, num);
 		return;
 	}
-	
-	//յڴ潫target_free_listָ
-	auto target_free_list = free_list + free_list_index(size);
-	obj *target_block = reinterpret_cast<obj*>(p);
-	target_block->free_list_link = *target_free_list;
-	*target_free_list = target_block;
+
+	obj *block = reinterpret_cast<obj*>(p);
+	chunk *c = chunk_of(p);
+	if (c->owner == local_cache.cache) {
+		free_local(c->owner, c, block);
+		return;
+	}
+
+	//̷߳Ŀ齻thread_cache
+	free_remote(c->owner, c->index, block);
 }
 
 
+template<typename T, typename SizeClass, typename ChunkSource>
+void free_list_allocator<T, SizeClass, ChunkSource>::allocate_batch(std::size_t num, T **result)
+{
+	aux_allocate_batch(num, result);
+	if (alloc_trace::enabled || heap_profile::enabled) {
+		for (std::size_t i = 0; i < num; ++i) {
+			alloc_trace::on_allocate(result[i], sizeof(T));
+			heap_profile::on_allocate<T>(result[i], sizeof(T));
+		}
+	}
+}
+
 
-template<typename T>
-T *free_list_allocator<T>::refill(std::size_t block_size)
+template<typename T, typename SizeClass, typename ChunkSource>
+void free_list_allocator<T, SizeClass, ChunkSource>::aux_allocate_batch(std::size_t num, T **result)
 {
-	//ĬϷ16ڴ
-	std::size_t num = 16;
-	//chunkָڴʼַ
-	char *chunk = chunk_alloc(block_size, num);   //num passed by reference
+	std::size_t i = 0;
 
-	if (num == 1) {
-		return reinterpret_cast<T*>(chunk);
+	if (!POOLED || sizeof(T) > MAX_BLOCK_SIZE) {
+		try {
+			for (; i < num; ++i) {
+				result[i] = large_allocate(1);
+			}
+		}
+		catch (...) {
+			deallocate_batch(result, i);
+			throw;
+		}
+		return;
 	}
 
-	auto target_free_list = free_list + free_list_index(block_size);
-	//һڴΪ
-	T *result = reinterpret_cast<T*>(chunk);
-	--num;
+	thread_cache *cache = local_cache.get();
+	std::size_t index = free_list_index(sizeof(T));
 
-	obj *cur_obj, *next_obj;
-	chunk += block_size;
-	cur_obj = reinterpret_cast<obj*>(chunk);
-	cur_obj->free_list_link = nullptr;
-	--num;
-	*target_free_list = cur_obj;
+	while (i < num)
+	{
+		chunk *current = cache->current[index];
+		if (current != nullptr)
+		{
+			std::size_t first = i;
+			for (obj *block = current->free_list; block != nullptr && i < num;
+				 block = current->free_list) {
+				current->free_list = block->free_list_link;
+				result[i++] = reinterpret_cast<T*>(block);
+			}
 
-	while (num > 0)
+			//ʣµĴڴһг
+			std::size_t carve = static_cast<std::size_t>(
+				current->end_pool - current->start_pool) / current->block_size;
+			if (carve > num - i) {
+				carve = num - i;
+			}
+			for (std::size_t k = 0; k < carve; ++k) {
+				result[i++] = reinterpret_cast<T*>(current->start_pool);
+				current->start_pool += current->block_size;
+			}
+
+			current->used += i - first;
+			count_used(cache, (i - first) * current->block_size, 0);
+			cache->stats[index].allocate.add(i - first);
+			if (i == num) {
+				break;
+			}
+		}
+
+		//ǰchunkþrefillµchunk
+		try {
+			result[i] = refill(cache, index);
+		}
+		catch (...) {
+			deallocate_batch(result, i);
+			throw;
+		}
+		++i;
+	}
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+void free_list_allocator<T, SizeClass, ChunkSource>::deallocate_batch(T **p, std::size_t num) noexcept
+{
+	if (alloc_trace::enabled || heap_profile::enabled) {
+		for (std::size_t i = 0; i < num; ++i) {
+			alloc_trace::on_deallocate(p[i], sizeof(T));
+			heap_profile::on_deallocate(p[i]);
+		}
+	}
+
+	if (!POOLED || sizeof(T) > MAX_BLOCK_SIZE) {
+		for (std::size_t i = 0; i < num; ++i) {
+			large_deallocate(p[i], 1);
+		}
+		return;
+	}
+
+	thread_cache *cache = local_cache.cache;
+	for (std::size_t i = 0; i < num; ++i)
 	{
-		chunk += block_size;
-		next_obj = reinterpret_cast<obj*>(chunk);
-		next_obj->free_list_link = nullptr;
-		--num;
-		cur_obj->free_list_link = next_obj;
-		cur_obj = next_obj;
+		obj *block = reinterpret_cast<obj*>(p[i]);
+		chunk *c = chunk_of(block);
+		if (c->owner == cache) {
+			free_local(cache, c, block);
+		}
+		else {
+			free_remote(c->owner, c->index, block);
+		}
+	}
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+typename free_list_allocator<T, SizeClass, ChunkSource>::obj *
+free_list_allocator<T, SizeClass, ChunkSource>::take_block(thread_cache *cache, chunk *c) noexcept
+{
+	obj *result = c->free_list;
+	if (result != nullptr) {
+		c->free_list = result->free_list_link;
+	}
+	else if (static_cast<std::size_t>(c->end_pool - c->start_pool) >=
+			 c->block_size) {
+		result = reinterpret_cast<obj*>(c->start_pool);
+		c->start_pool += c->block_size;
+	}
+	else {
+		return nullptr;
 	}
 
+	++c->used;
+	count_used(cache, c->block_size, 0);
+	cache->stats[c->index].allocate.add();
 	return result;
 }
 
 
-template<typename T>
-char *
-free_list_allocator<T>::chunk_alloc(std::size_t block_size, std::size_t& num)
+template<typename T, typename SizeClass, typename ChunkSource>
+T *free_list_allocator<T, SizeClass, ChunkSource>::refill(thread_cache *cache, std::size_t index)
 {
-	char *result;
-	/*
-	total_byte: ܹҪbyte
-	left_byte: ڴʣbyte
-	*/
-	std::size_t total_byte = block_size * num;
-	std::size_t left_byte = end_pool - start_pool;
+	chunk *current = cache->current[index];
+	obj *result;
 
-	if (left_byte > total_byte)
+	if (current != nullptr)
 	{
-		result = start_pool;
-		start_pool += total_byte;
-		return result;
+		result = take_block(cache, current);
+		if (result != nullptr) {
+			return reinterpret_cast<T*>(result);
+		}
+
+		//̹߳黹Ŀʹǰchunk¿
+		collect_remote(cache, index);
+		result = take_block(cache, current);
+		if (result != nullptr) {
+			return reinterpret_cast<T*>(result);
+		}
 	}
-	else if (left_byte > block_size)
+
+	//µchunkżΪһrefill
+	cache->stats[index].refill.add();
+	chunk *next = cache->available[index];
+	if (next != nullptr) {
+		unlink_available(cache, next);
+	}
+	else {
+		//chunk_alloc׳ʱcurrentǵǰchunkܱΪ
+		next = chunk_alloc(cache, index);
+	}
+
+	if (current != nullptr) {
+		current->full = true;
+	}
+	cache->current[index] = next;
+	return reinterpret_cast<T*>(take_block(cache, next));
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+typename free_list_allocator<T, SizeClass, ChunkSource>::chunk *
+free_list_allocator<T, SizeClass, ChunkSource>::chunk_alloc(thread_cache *cache, std::size_t index)
+{
+	chunk *result;
 	{
-		//num: ʵʷĿĸ
-		num = left_byte / block_size;
-		result = start_pool;
-		start_pool += num * block_size;
-		return result;
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		result = free_chunks;
+
+		if (result != nullptr) {
+			free_chunks = result->next;
+		}
+		else {
+			result = static_cast<chunk*>(
+				ChunkSource::allocate(CHUNK_SIZE, CHUNK_SIZE));
+			heap_size += CHUNK_SIZE;
+
+			result->pool_prev = nullptr;
+			result->pool_next = chunks;
+			if (chunks != nullptr) {
+				chunks->pool_prev = result;
+			}
+			chunks = result;
+			++chunk_num;
+		}
+	}
+
+	result->owner = cache;
+	result->prev = nullptr;
+	result->next = nullptr;
+	result->free_list = nullptr;
+	result->start_pool = reinterpret_cast<char*>(result) + round_up(sizeof(chunk));
+	result->end_pool = reinterpret_cast<char*>(result) + CHUNK_SIZE;
+	result->index = index;
+	result->block_size = class_size(index);
+	result->used = 0;
+	result->full = false;
+
+	cache->stats[index].chunk_alloc.add();
+	cache->stats[index].chunks.add();
+	return result;
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+void free_list_allocator<T, SizeClass, ChunkSource>::chunk_free(chunk *c) noexcept
+{
+	c->owner->stats[c->index].chunks.sub();
+
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	c->owner = nullptr;
+	c->next = free_chunks;
+	free_chunks = c;
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+void free_list_allocator<T, SizeClass, ChunkSource>::free_local(thread_cache *cache, chunk *c,
+										obj *block) noexcept
+{
+	//յڴ潫chunkfree_list
+	block->free_list_link = c->free_list;
+	c->free_list = block;
+	--c->used;
+	count_used(cache, 0, c->block_size);
+	cache->stats[c->index].deallocate.add();
+
+	if (c->full) {
+		c->full = false;
+		link_available(cache, c);
 	}
-	else
+	else if (c->used == 0 && c != cache->current[c->index]) {
+		unlink_available(cache, c);
+		chunk_free(c);
+	}
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+void free_list_allocator<T, SizeClass, ChunkSource>::free_remote(thread_cache *owner, std::size_t index,
+										 obj *block) noexcept
+{
+	std::atomic<obj*>& head = owner->remote_free[index];
+	obj *old_head = head.load(std::memory_order_relaxed);
+
+	do {
+		block->free_list_link = old_head;
+	} while (!head.compare_exchange_weak(old_head, block,
+			 std::memory_order_release, std::memory_order_relaxed));
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+void free_list_allocator<T, SizeClass, ChunkSource>::collect_remote(thread_cache *cache,
+											std::size_t index) noexcept
+{
+	obj *block = cache->remote_free[index].exchange(nullptr,
+		std::memory_order_acquire);
+
+	while (block != nullptr)
 	{
-		//ڴ´С
-		std::size_t byte_to_get = 2 * total_byte + round_up(heap_size >> 4);
+		obj *next = block->free_list_link;
+		free_local(cache, chunk_of(block), block);
+		block = next;
+	}
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+void free_list_allocator<T, SizeClass, ChunkSource>::link_available(thread_cache *cache,
+											chunk *c) noexcept
+{
+	chunk *&head = cache->available[c->index];
+	c->prev = nullptr;
+	c->next = head;
+	if (head != nullptr) {
+		head->prev = c;
+	}
+	head = c;
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+void free_list_allocator<T, SizeClass, ChunkSource>::unlink_available(thread_cache *cache,
+											  chunk *c) noexcept
+{
+	if (c->prev != nullptr) {
+		c->prev->next = c->next;
+	}
+	else {
+		cache->available[c->index] = c->next;
+	}
+
+	if (c->next != nullptr) {
+		c->next->prev = c->prev;
+	}
+	c->prev = nullptr;
+	c->next = nullptr;
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+typename free_list_allocator<T, SizeClass, ChunkSource>::thread_cache *
+free_list_allocator<T, SizeClass, ChunkSource>::cache_handle::get()
+{
+	if (cache != nullptr) {
+		return cache;
+	}
+
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	//Ƚӹ˳߳µthread_cachechunk
+	for (thread_cache *iter = caches; iter != nullptr; iter = iter->next)
+	{
+		if (iter->retired) {
+			iter->retired = false;
+			cache = iter;
+			return cache;
+		}
+	}
+
+	cache = new thread_cache();
+	cache->next = caches;
+	caches = cache;
+	return cache;
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+free_list_allocator<T, SizeClass, ChunkSource>::cache_handle::~cache_handle() noexcept
+{
+	if (cache == nullptr) {
+		return;
+	}
 
-		if (left_byte > 0) {
-			//Ŀռȥ
-			obj *new_head = reinterpret_cast<obj*>(start_pool);
-			auto target_free_list = free_list + free_list_index(left_byte);
+	//߳˳ʱյchunk黹ĳ
+	release_empty(cache);
 
-			new_head->free_list_link = *target_free_list;
-			*target_free_list = new_head;
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	cache->retired = true;
+	cache = nullptr;
+}
 
-			start_pool = end_pool = nullptr;
+
+template<typename T, typename SizeClass, typename ChunkSource>
+void free_list_allocator<T, SizeClass, ChunkSource>::release_empty(thread_cache *cache) noexcept
+{
+	for (std::size_t i = 0; i < FREE_LIST_NUM; ++i)
+	{
+		collect_remote(cache, i);
+
+		for (chunk *c = cache->available[i]; c != nullptr; )
+		{
+			chunk *next = c->next;
+			if (c->used == 0) {
+				unlink_available(cache, c);
+				chunk_free(c);
+			}
+			c = next;
 		}
 
-		start_pool = static_cast<char*>(malloc(byte_to_get));
-		if (start_pool == nullptr) {
-			obj **target_free_list;
-			obj *head;		//ָ free_list ĵһڴ
+		chunk *current = cache->current[i];
+		if (current != nullptr && current->used == 0) {
+			cache->current[i] = nullptr;
+			chunk_free(current);
+		}
+	}
+}
 
-			/*
-			С block_size  free_list 
-			ȡеڴ뵽ڴ
-			*/
-			for (std::size_t i = block_size + ALIGN; i <= MAX_BLOCK_SIZE; i += ALIGN) {
-				
-				target_free_list = free_list + free_list_index(i);
-				head = *target_free_list;
 
-				if (head != nullptr) {
-					/*
-					пп뵽ڴ
-					*/
-					*target_free_list = head->free_list_link;
-					start_pool = reinterpret_cast<char*>(head);
-					end_pool = start_pool + i;
-					return chunk_alloc(block_size, num);
-				}
+template<typename T, typename SizeClass, typename ChunkSource>
+std::size_t free_list_allocator<T, SizeClass, ChunkSource>::trim() noexcept
+{
+	if (local_cache.cache != nullptr) {
+		release_empty(local_cache.cache);
+	}
+
+	thread_cache *head;
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		head = caches;
+	}
 
+	//ʱӹ˳̵߳cacheпյchunk
+	for (thread_cache *cache = head; cache != nullptr; cache = cache->next)
+	{
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			if (!cache->retired) {
+				continue;
 			}
+			cache->retired = false;
+		}
 
-			start_pool = reinterpret_cast<char*>(
-					malloc_allocator<T>::allocate(byte_to_get / sizeof(T)));
+		release_empty(cache);
+
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		cache->retired = true;
+	}
+
+	std::size_t released = 0;
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	while (free_chunks != nullptr)
+	{
+		chunk *c = free_chunks;
+		free_chunks = c->next;
+
+		if (c->pool_prev != nullptr) {
+			c->pool_prev->pool_next = c->pool_next;
+		}
+		else {
+			chunks = c->pool_next;
+		}
+		if (c->pool_next != nullptr) {
+			c->pool_next->pool_prev = c->pool_prev;
 		}
+		--chunk_num;
+
+		ChunkSource::deallocate(c, CHUNK_SIZE, CHUNK_SIZE);
+		released += CHUNK_SIZE;
+	}
+
+	return released;
+}
 
-		end_pool = start_pool + byte_to_get;
-		heap_size += byte_to_get;
-		return chunk_alloc(block_size, num);
+
+template<typename T, typename SizeClass, typename ChunkSource>
+void free_list_allocator<T, SizeClass, ChunkSource>::start_background_trim(
+		std::chrono::milliseconds period)
+{
+	std::lock_guard<std::mutex> lock(background.trim_mutex);
+	if (background.trim_thread.joinable()) {
+		return;
 	}
+
+	background.stop = false;
+	background.trim_thread = std::thread([period]() {
+		std::unique_lock<std::mutex> lock(background.trim_mutex);
+		while (!background.trim_cond.wait_for(lock, period,
+			   []() { return background.stop; }))
+		{
+			lock.unlock();
+			trim();
+			lock.lock();
+		}
+	});
 }
 
 
-template<typename T1, typename T2>
-bool operator==(const free_list_allocator<T1>&, const free_list_allocator<T2>&)
+template<typename T, typename SizeClass, typename ChunkSource>
+void free_list_allocator<T, SizeClass, ChunkSource>::stop_background_trim()
+{
+	std::thread t;
+	{
+		std::lock_guard<std::mutex> lock(background.trim_mutex);
+		background.stop = true;
+		t = std::move(background.trim_thread);
+	}
+
+	background.trim_cond.notify_all();
+	if (t.joinable()) {
+		t.join();
+	}
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+std::size_t free_list_allocator<T, SizeClass, ChunkSource>::get_heap_size() noexcept
+{
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	return heap_size;
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+std::size_t free_list_allocator<T, SizeClass, ChunkSource>::reserved_bytes() noexcept
+{
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	return chunk_num * CHUNK_SIZE;
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+std::size_t free_list_allocator<T, SizeClass, ChunkSource>::used_bytes() noexcept
+{
+	std::size_t bytes = 0;
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	for (thread_cache *cache = caches; cache != nullptr; cache = cache->next) {
+		bytes += cache->used_bytes.load(std::memory_order_relaxed);
+	}
+
+	return bytes;
+}
+
+
+template<typename T, typename SizeClass, typename ChunkSource>
+allocator_stats free_list_allocator<T, SizeClass, ChunkSource>::stats()
+{
+	allocator_stats result;
+	result.classes.resize(FREE_LIST_NUM);
+	for (std::size_t i = 0; i < FREE_LIST_NUM; ++i) {
+		result.classes[i].size = class_size(i);
+	}
+
+	result.large_allocate = large_stats.allocate.get();
+	result.large_deallocate = large_stats.deallocate.get();
+	result.large_bytes = large_stats.bytes.get();
+	result.oom_calls = alloc_stats::oom_calls().get();
+
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	result.heap_bytes = heap_size;
+	result.reserved_bytes = chunk_num * CHUNK_SIZE;
+	result.chunks = chunk_num;
+
+	for (thread_cache *cache = caches; cache != nullptr; cache = cache->next)
+	{
+		result.used_bytes += cache->used_bytes.load(std::memory_order_relaxed);
+
+		for (std::size_t i = 0; i < FREE_LIST_NUM; ++i)
+		{
+			size_class_stats& c = result.classes[i];
+			c.allocate += cache->stats[i].allocate.get();
+			c.deallocate += cache->stats[i].deallocate.get();
+			c.refill += cache->stats[i].refill.get();
+			c.chunk_alloc += cache->stats[i].chunk_alloc.get();
+			c.chunks += cache->stats[i].chunks.get();
+		}
+	}
+
+	//̹߳黹δջصĿԼΪѷ
+	for (std::size_t i = 0; i < FREE_LIST_NUM; ++i)
+	{
+		size_class_stats& c = result.classes[i];
+		std::size_t capacity = c.chunks * chunk_capacity(i);
+		c.used_blocks = c.allocate > c.deallocate ? c.allocate - c.deallocate : 0;
+		c.free_blocks = capacity > c.used_blocks ? capacity - c.used_blocks : 0;
+	}
+
+	return result;
+}
+
+
+template<typename T1, typename T2, typename SizeClass, typename ChunkSource>
+bool operator==(const free_list_allocator<T1, SizeClass, ChunkSource>&,
+				const free_list_allocator<T2, SizeClass, ChunkSource>&)
+{
+	return true;
+}
+
+template<typename T1, typename T2, typename SizeClass, typename ChunkSource>
+bool operator!=(const free_list_allocator<T1, SizeClass, ChunkSource>&,
+				const free_list_allocator<T2, SizeClass, ChunkSource>&)
+{
+	return false;
+}
+
+
+/*
+  pads every allocation to a multiple of Align and aligns it to Align, so
+  nodes written by different threads never share a cache line. Use it as
+  the Alloc parameter of a container, e.g.
+  cx_list<counter, cache_aligned_allocator<list_node<counter>>>
+*/
+template<typename T, std::size_t Align = CACHE_LINE_SIZE,
+		 typename SizeClass = geometric_size_classes<>,
+		 typename ChunkSource = malloc_chunk_source>
+class cache_aligned_allocator
+{
+private:
+	struct alignas(Align > alignof(T) ? Align : alignof(T)) block
+	{
+		char data[sizeof(T)];
+	};
+
+	using base_allocator = free_list_allocator<block, SizeClass, ChunkSource>;
+
+public:
+	typedef T value_type;
+
+	//the alignment parameter keeps allocator_traits from rebinding by itself
+	template<typename U>
+	struct rebind
+	{
+		using other = cache_aligned_allocator<U, Align, SizeClass, ChunkSource>;
+	};
+
+	cache_aligned_allocator() {}
+	template<typename U>
+	cache_aligned_allocator(
+		const cache_aligned_allocator<U, Align, SizeClass, ChunkSource>&) {}
+
+	static T *allocate(std::size_t num)
+	{
+		return reinterpret_cast<T*>(base_allocator::allocate(num));
+	}
+
+	static void deallocate(T *p, std::size_t num) noexcept
+	{
+		base_allocator::deallocate(reinterpret_cast<block*>(p), num);
+	}
+
+	static void allocate_batch(std::size_t num, T **result)
+	{
+		base_allocator::allocate_batch(num, reinterpret_cast<block**>(result));
+	}
+
+	static void deallocate_batch(T **p, std::size_t num) noexcept
+	{
+		base_allocator::deallocate_batch(reinterpret_cast<block**>(p), num);
+	}
+
+	static allocator_stats stats() { return base_allocator::stats(); }
+};
+
+
+template<typename T1, typename T2, std::size_t Align, typename SizeClass,
+		 typename ChunkSource>
+bool operator==(const cache_aligned_allocator<T1, Align, SizeClass, ChunkSource>&,
+				const cache_aligned_allocator<T2, Align, SizeClass, ChunkSource>&)
 {
 	return true;
 }
 
-template<typename T1, typename T2>
-bool operator!=(const free_list_allocator<T1>&, const free_list_allocator<T2>&)
+template<typename T1, typename T2, std::size_t Align, typename SizeClass,
+		 typename ChunkSource>
+bool operator!=(const cache_aligned_allocator<T1, Align, SizeClass, ChunkSource>&,
+				const cache_aligned_allocator<T2, Align, SizeClass, ChunkSource>&)
 {
 	return false;
 }
@@ -0,0 +1,377 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <typeinfo>
+#include <ostream>
+#include <cstdlib>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#define CX_HAS_BACKTRACE
+#endif
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+
+/*
+  sampling heap profiler. With CX_HEAP_PROFILE defined, free_list_allocator,
+  slab_allocator, malloc_allocator and mremap_allocator sample on average
+  one allocation per sample_period() bytes (a Poisson process over the
+  allocated bytes) and keep the stack and the allocated type of every
+  sampled block until it is freed. Each sample stands for the bytes it
+  statistically represents, so
+	heap_profile::write_report(std::cout);
+  shows the estimated live heap by call site and type. Without the macro
+  the hooks are empty.
+  budget_allocator is seen through the allocator it wraps. Memory handed
+  out by arena_allocator and the memory resources, and the raw chunks
+  behind the free lists, is not sampled.
+*/
+namespace heap_profile {
+
+#ifdef CX_HEAP_PROFILE
+	constexpr bool enabled = true;
+#else
+	constexpr bool enabled = false;
+#endif
+
+	constexpr std::size_t MAX_DEPTH = 32;
+	constexpr std::size_t DEFAULT_SAMPLE_PERIOD = 512 * 1024;
+
+
+	struct sample
+	{
+		const std::type_info *type;
+		std::size_t size;
+		std::size_t depth;
+		void *stack[MAX_DEPTH];
+	};
+
+
+	//live samples grouped by stack and type
+	struct site
+	{
+		const std::type_info *type;
+		std::vector<void*> stack;
+		std::size_t samples = 0;
+		double bytes = 0.0;     //estimated live bytes
+		double blocks = 0.0;    //estimated live blocks
+	};
+
+
+	class profiler
+	{
+	private:
+		//counting filter over the sampled addresses, lets deallocate skip
+		//the lock for the blocks that were never sampled
+		static constexpr std::size_t FILTER_SIZE = 4096;
+
+		std::atomic<std::size_t> period{ DEFAULT_SAMPLE_PERIOD };
+		std::atomic<std::uint32_t> filter[FILTER_SIZE] = {};
+		std::mutex mutex;
+		std::unordered_map<const void*, sample> samples;
+
+		profiler() {}
+
+		static std::size_t slot(const void *p) noexcept
+		{
+			std::uintptr_t x = reinterpret_cast<std::uintptr_t>(p) >> 4;
+			x ^= x >> 17;
+			x *= 0x9E3779B97F4A7C15ull & std::uintptr_t(-1);
+			return (x >> 7) % FILTER_SIZE;
+		}
+
+	public:
+		static profiler& instance()
+		{
+			static profiler p;
+			return p;
+		}
+
+		std::size_t sample_period() const noexcept { return period.load(std::memory_order_relaxed); }
+		void set_sample_period(std::size_t byte) noexcept {
+			period.store(byte > 0 ? byte : 1, std::memory_order_relaxed);
+		}
+
+		void add(const void *p, const std::type_info& type, std::size_t byte) noexcept;
+		void remove(const void *p) noexcept;
+		//remove that hands back the sample, false if p was not sampled
+		bool take(const void *p, sample& s) noexcept;
+		void put(const void *p, const sample& s) noexcept;
+		std::vector<site> live_sites();
+	};
+
+
+	//bytes left before the next sample of this thread
+	struct thread_state
+	{
+		std::int64_t countdown;
+		std::uint64_t random;
+	};
+
+	inline thread_state& local_state() noexcept
+	{
+		static thread_local thread_state state = { 0, 0 };
+		return state;
+	}
+
+	//exponential interval with mean sample_period()
+	inline std::int64_t next_interval(thread_state& s) noexcept
+	{
+		if (s.random == 0) {
+			s.random = reinterpret_cast<std::uintptr_t>(&s) | 1;
+		}
+		//xorshift64
+		s.random ^= s.random << 13;
+		s.random ^= s.random >> 7;
+		s.random ^= s.random << 17;
+
+		double u = ((s.random >> 11) + 1) * (1.0 / 9007199254740993.0);
+		double interval = -std::log(u) * profiler::instance().sample_period();
+		return static_cast<std::int64_t>(interval) + 1;
+	}
+
+
+	inline void profiler::add(const void *p, const std::type_info& type,
+							  std::size_t byte) noexcept
+	{
+		sample s;
+		s.type = &type;
+		s.size = byte;
+#if defined(_WIN32)
+		s.depth = CaptureStackBackTrace(1, MAX_DEPTH, s.stack, nullptr);
+#elif defined(CX_HAS_BACKTRACE)
+		s.depth = backtrace(s.stack, MAX_DEPTH);
+#else
+		s.depth = 0;
+#endif
+
+		try {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (samples.insert(std::make_pair(p, s)).second) {
+				filter[slot(p)].fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		catch (...) {
+			//the sample is dropped when there is no memory to keep it
+		}
+	}
+
+
+	inline void profiler::remove(const void *p) noexcept
+	{
+		if (filter[slot(p)].load(std::memory_order_relaxed) == 0) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (samples.erase(p) > 0) {
+			filter[slot(p)].fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+
+	inline bool profiler::take(const void *p, sample& s) noexcept
+	{
+		if (filter[slot(p)].load(std::memory_order_relaxed) == 0) {
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto iter = samples.find(p);
+		if (iter == samples.end()) {
+			return false;
+		}
+		s = iter->second;
+		samples.erase(iter);
+		filter[slot(p)].fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+
+	inline void profiler::put(const void *p, const sample& s) noexcept
+	{
+		try {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (samples.insert(std::make_pair(p, s)).second) {
+				filter[slot(p)].fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		catch (...) {
+		}
+	}
+
+
+	inline std::vector<site> profiler::live_sites()
+	{
+		std::vector<site> result;
+		double rate = 1.0 / sample_period();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const auto& entry : samples)
+		{
+			const sample& s = entry.second;
+			auto iter = std::find_if(result.begin(), result.end(), [&s](const site& x) {
+				return x.type == s.type && x.stack.size() == s.depth &&
+					std::equal(x.stack.begin(), x.stack.end(), s.stack);
+			});
+			if (iter == result.end()) {
+				result.push_back(site());
+				iter = result.end() - 1;
+				iter->type = s.type;
+				iter->stack.assign(s.stack, s.stack + s.depth);
+			}
+
+			//a block of size bytes is sampled with probability 1 - e^(-size/period)
+			double probability = 1.0 - std::exp(-static_cast<double>(s.size) * rate);
+			++iter->samples;
+			iter->bytes += s.size / probability;
+			iter->blocks += 1.0 / probability;
+		}
+
+		std::sort(result.begin(), result.end(),
+			[](const site& lhs, const site& rhs) { return lhs.bytes > rhs.bytes; });
+		return result;
+	}
+
+
+
+	inline std::size_t sample_period() noexcept { return profiler::instance().sample_period(); }
+	inline void set_sample_period(std::size_t byte) noexcept {
+		profiler::instance().set_sample_period(byte);
+	}
+	inline std::vector<site> live_sites() { return profiler::instance().live_sites(); }
+
+
+	//hooks of the allocators, nothing unless CX_HEAP_PROFILE is defined
+	template<typename T>
+	inline void on_allocate(const void *p, std::size_t byte) noexcept
+	{
+		if (!enabled) {
+			return;
+		}
+
+		thread_state& s = local_state();
+		s.countdown -= static_cast<std::int64_t>(byte);
+		if (s.countdown > 0) {
+			return;
+		}
+
+		//the first call of a thread only starts its countdown
+		bool first = s.random == 0;
+		s.countdown = next_interval(s);
+		if (!first) {
+			profiler::instance().add(p, typeid(T), byte);
+		}
+	}
+
+	inline void on_deallocate(const void *p) noexcept
+	{
+		if (enabled) {
+			profiler::instance().remove(p);
+		}
+	}
+
+	/*
+	  hook of a reallocation, made while p is still live: p's sample is
+	  taken out and done() records the new block. If the reallocation
+	  throws before that, the sample goes back to p, which is then still
+	  live.
+	*/
+	class reallocation
+	{
+	private:
+		const void *old;
+		bool sampled;
+		sample saved;
+
+	public:
+		explicit reallocation(const void *p) noexcept: old(p), sampled(false) {
+			if (enabled) {
+				sampled = profiler::instance().take(p, saved);
+			}
+		}
+		reallocation(const reallocation&) = delete;
+		reallocation& operator=(const reallocation&) = delete;
+		~reallocation() {
+			if (sampled) {
+				profiler::instance().put(old, saved);
+			}
+		}
+
+		template<typename T>
+		void done(const void *p, std::size_t byte) noexcept {
+			sampled = false;
+			on_allocate<T>(p, byte);
+		}
+		//p was freed after all, its sample is not put back
+		void lost() noexcept { sampled = false; }
+	};
+
+
+	inline void write_type(std::ostream& os, const std::type_info& type)
+	{
+#ifdef __GNUG__
+		int status = 0;
+		char *name = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+		if (status == 0 && name != nullptr) {
+			os << name;
+			std::free(name);
+			return;
+		}
+#endif
+		os << type.name();
+	}
+
+
+	//the max_sites sites holding the most estimated bytes, with their stacks
+	inline void write_report(std::ostream& os, std::size_t max_sites = 20)
+	{
+		std::vector<site> sites = live_sites();
+		double total = 0.0;
+		for (const site& s : sites) {
+			total += s.bytes;
+		}
+
+		os << "heap profile: " << static_cast<std::size_t>(total)
+		   << " live bytes estimated, sample period " << sample_period() << '\n';
+
+		for (std::size_t i = 0; i < sites.size() && i < max_sites; ++i)
+		{
+			const site& s = sites[i];
+			os << static_cast<std::size_t>(s.bytes) << " bytes in "
+			   << static_cast<std::size_t>(s.blocks) << " blocks ("
+			   << s.samples << " samples) of ";
+			write_type(os, *s.type);
+			os << '\n';
+
+#ifdef CX_HAS_BACKTRACE
+			char **symbols = backtrace_symbols(s.stack.data(), static_cast<int>(s.stack.size()));
+			for (std::size_t k = 0; k < s.stack.size(); ++k) {
+				os << "    " << (symbols != nullptr ? symbols[k] : "?") << '\n';
+			}
+			std::free(symbols);
+#else
+			for (void *frame : s.stack) {
+				os << "    " << frame << '\n';
+			}
+#endif
+		}
+	}
+}
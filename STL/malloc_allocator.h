@@ -1,5 +1,10 @@
 #pragma once
+#include "alloc_stats.h"
+#include "heap_profile.h"
 #include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <new>
 
 template<typename T>
@@ -10,12 +15,36 @@ public:
 	typedef T value_type;
 
 private:
+	//malloc only guarantees the alignment of max_align_t
+	static constexpr bool OVER_ALIGNED =
+		alignof(T) > alignof(std::max_align_t);
+
 	//oom: out of memory
 	static T *oom_malloc(size_t n);
 	static T *oom_realloc(T *p, size_t n);
+	static void *oom_aligned_malloc(std::size_t n, std::size_t align);
 	
 	static void (*oom_handler)();
 
+	static void *aligned_malloc(std::size_t n, std::size_t align) noexcept
+	{
+#ifdef _MSC_VER
+		return _aligned_malloc(n, align);
+#else
+		//aligned_alloc wants the size to be a multiple of align
+		return std::aligned_alloc(align, (n + align - 1) & ~(align - 1));
+#endif
+	}
+
+	static void aligned_free(void *p) noexcept
+	{
+#ifdef _MSC_VER
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+
 
 public:
 	malloc_allocator() {}
@@ -25,9 +54,17 @@ public:
 	}
 
 	static T *allocate(std::size_t num);
+	//without _aligned_realloc an over-aligned block that realloc moved off
+	//its alignment is lost if moving it again throws, use the form below
 	static T *reallocate(T *p, std::size_t num);
+	//the form containers call, p is left intact when it throws
+	static T *reallocate(T *p, std::size_t old_num, std::size_t num);
 	static void deallocate(T *p, std::size_t num) noexcept;
 
+	//byte bytes aligned to align (a power of 2), freed by aligned_deallocate
+	static void *aligned_allocate(std::size_t byte, std::size_t align);
+	static void aligned_deallocate(void *p) noexcept { aligned_free(p); }
+
 
 	void (*set_oom_handler(void (*handler)()))() noexcept;
 };
@@ -40,11 +77,18 @@ void (*malloc_allocator<T>::oom_handler)() = nullptr;
 template<typename T>
 T *malloc_allocator<T>::allocate(std::size_t num) 
 {
-	T *result = static_cast<T*>(malloc(num * sizeof(T)));
-	if (result == nullptr) {
-		result = oom_malloc(num * sizeof(T));
+	T *result;
+	if (OVER_ALIGNED) {
+		result = static_cast<T*>(aligned_allocate(num * sizeof(T), alignof(T)));
+	}
+	else {
+		result = static_cast<T*>(malloc(num * sizeof(T)));
+		if (result == nullptr) {
+			result = oom_malloc(num * sizeof(T));
+		}
 	}
 
+	heap_profile::on_allocate<T>(result, num * sizeof(T));
 	return result;
 }
 
@@ -52,21 +96,101 @@ T *malloc_allocator<T>::allocate(std::size_t num)
 template<typename T>
 T *malloc_allocator<T>::reallocate(T *p, std::size_t num) 
 {
+	//p is dead once realloc returns, its sample is taken out first
+	heap_profile::reallocation profile(p);
+
+#ifdef _MSC_VER
+	if (OVER_ALIGNED) {
+		T *result = static_cast<T*>(
+			_aligned_realloc(p, num * sizeof(T), alignof(T)));
+		while (result == nullptr)
+		{
+			if (oom_handler == nullptr)
+				throw std::bad_alloc();
+			alloc_stats::oom_calls().add();
+			oom_handler();
+
+			result = static_cast<T*>(
+				_aligned_realloc(p, num * sizeof(T), alignof(T)));
+		}
+		profile.done<T>(result, num * sizeof(T));
+		return result;
+	}
+#endif
+
 	T *result = static_cast<T*>(realloc(p, num * sizeof(T)));
 	if (result == nullptr) {
 		result = oom_realloc(p, num * sizeof(T));
 	}
 
+	//realloc may lose the alignment, move the block if it did
+	if (OVER_ALIGNED &&
+		reinterpret_cast<std::uintptr_t>(result) % alignof(T) != 0) {
+		void *aligned;
+		try {
+			aligned = aligned_allocate(num * sizeof(T), alignof(T));
+		}
+		catch (...) {
+			//p is gone already, do not leak the block realloc returned
+			free(result);
+			profile.lost();
+			throw;
+		}
+		std::memcpy(aligned, static_cast<void*>(result), num * sizeof(T));
+		free(result);
+		result = static_cast<T*>(aligned);
+	}
+
+	profile.done<T>(result, num * sizeof(T));
 	return result;
 }
 
 
+template<typename T>
+T *malloc_allocator<T>::reallocate(T *p, std::size_t old_num, std::size_t num)
+{
+#ifndef _MSC_VER
+	//realloc frees p before its result could be re-aligned, so an
+	//over-aligned block is copied by hand and survives a failed allocation
+	if (OVER_ALIGNED) {
+		T *result = allocate(num);
+		std::size_t n = old_num < num ? old_num : num;
+		if (n != 0) {
+			std::memcpy(static_cast<void*>(result), static_cast<const void*>(p), n * sizeof(T));
+		}
+		deallocate(p, old_num);
+		return result;
+	}
+#endif
+	return reallocate(p, num);
+}
+
+
 template<typename T>
 void malloc_allocator<T>::deallocate(T *p, std::size_t num) noexcept
 {
+	heap_profile::on_deallocate(p);
+	if (OVER_ALIGNED) {
+		aligned_free(p);
+		return;
+	}
+
 	free(p);
 }
 
+
+template<typename T>
+void *malloc_allocator<T>::aligned_allocate(std::size_t byte, std::size_t align)
+{
+	void *result = aligned_malloc(byte, align);
+	if (result == nullptr) {
+		result = oom_aligned_malloc(byte, align);
+	}
+
+	return result;
+}
+
+
 template<typename T>
 void (*malloc_allocator<T>::set_oom_handler(void (*handler)()))() noexcept
 {
@@ -85,6 +209,7 @@ T *malloc_allocator<T>::oom_malloc(std::size_t n)
 	{
 		if (oom_handler == nullptr)
 			throw std::bad_alloc();
+		alloc_stats::oom_calls().add();
 		oom_handler();
 
 		result = static_cast<T*>(malloc(n));
@@ -102,6 +227,7 @@ T *malloc_allocator<T>::oom_realloc(T *p, std::size_t n)
 	{
 		if (oom_handler == nullptr)
 			throw std::bad_alloc();
+		alloc_stats::oom_calls().add();
 		oom_handler();
 		
 		result = static_cast<T*>(realloc(p, n));
@@ -111,6 +237,24 @@ T *malloc_allocator<T>::oom_realloc(T *p, std::size_t n)
 }
 
 
+template<typename T>
+void *malloc_allocator<T>::oom_aligned_malloc(std::size_t n, std::size_t align)
+{
+	void *result = aligned_malloc(n, align);
+	while (result == nullptr)
+	{
+		if (oom_handler == nullptr)
+			throw std::bad_alloc();
+		alloc_stats::oom_calls().add();
+		oom_handler();
+
+		result = aligned_malloc(n, align);
+	}
+
+	return result;
+}
+
+
 template<typename T1, typename T2>
 bool operator==(const malloc_allocator<T1>&, const malloc_allocator<T2>&)
 {
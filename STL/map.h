@@ -1,10 +1,10 @@
 #pragma once
-#include "free_list_allocator.h"
+#include "slab_allocator.h"
 #include "rb_tree.h"
 namespace cx
 {
 template<typename Key, typename T, typename Compare = std::less<Key>,
-	     typename Alloc = free_list_allocator<
+	     typename Alloc = slab_allocator<
 			rb_tree_node<std::pair<const Key, T>>>>
 class map
 {
@@ -29,19 +29,42 @@ public:
 	using size_type = typename rb_tree_t::size_type;
 
 public:
-	explicit map(const key_compare& comp = key_compare()) : tree(comp) {}
+	explicit map(const key_compare& comp = key_compare(),
+		const allocator_type& alloc = allocator_type()) : tree(comp, alloc) {}
+
+	explicit map(const allocator_type& alloc) : tree(alloc) {}
 
 	template<typename InputIterator>
 	map(InputIterator first, InputIterator last,
-		const key_compare& comp = key_compare()) : tree(first, last, comp) {}
+		const key_compare& comp = key_compare(),
+		const allocator_type& alloc = allocator_type()) :
+		tree(first, last, comp, alloc) {}
 
 	map(const map& m) : tree(m.tree) {}
 
+	map(const map& m, const allocator_type& alloc) : tree(m.tree, alloc) {}
+
 	map(map&& m) noexcept : tree(std::move(m.tree)) {}
 
+	map(map&& m, const allocator_type& alloc) :
+		tree(std::move(m.tree), alloc) {}
+
 	map(std::initializer_list<value_type> l,
-		const key_compare& comp = key_compare()) :
-		tree(l, comp) {}
+		const key_compare& comp = key_compare(),
+		const allocator_type& alloc = allocator_type()) :
+		tree(l, comp, alloc) {}
+
+	map& operator=(const map& m) {
+		tree = m.tree;
+		return *this;
+	}
+
+	map& operator=(map&& m) noexcept(noexcept(tree = std::move(m.tree))) {
+		tree = std::move(m.tree);
+		return *this;
+	}
+
+	allocator_type get_allocator() const noexcept { return tree.get_allocator(); }
 
 	key_compare key_comp() const noexcept { return tree.comp; }
 	iterator begin() noexcept { return tree.begin(); }
@@ -107,7 +130,7 @@ public:
 
 
 template<typename Key, typename T, typename Compare = std::less<T>,
-		 typename Alloc = free_list_allocator<
+		 typename Alloc = slab_allocator<
 			rb_tree_node<std::pair<const Key, T>>>>
 class multimap
 {
@@ -132,19 +155,42 @@ public:
 	using size_type = typename rb_tree_t::size_type;
 
 public:
-	explicit multimap(const key_compare& comp = key_compare()) : tree(comp) {}
+	explicit multimap(const key_compare& comp = key_compare(),
+		const allocator_type& alloc = allocator_type()) : tree(comp, alloc) {}
+
+	explicit multimap(const allocator_type& alloc) : tree(alloc) {}
 
 	template<typename InputIterator>
 	multimap(InputIterator first, InputIterator last,
-		const key_compare& comp = key_compare()) : tree(first, last, comp) {}
+		const key_compare& comp = key_compare(),
+		const allocator_type& alloc = allocator_type()) :
+		tree(first, last, comp, alloc) {}
 
 	multimap(const multimap& m) : tree(m.tree) {}
 
+	multimap(const multimap& m, const allocator_type& alloc) : tree(m.tree, alloc) {}
+
 	multimap(multimap&& m) noexcept : tree(std::move(m.tree)) {}
 
+	multimap(multimap&& m, const allocator_type& alloc) :
+		tree(std::move(m.tree), alloc) {}
+
 	multimap(std::initializer_list<value_type> l,
-		const key_compare& comp = key_compare()) :
-		tree(l, comp) {}
+		const key_compare& comp = key_compare(),
+		const allocator_type& alloc = allocator_type()) :
+		tree(l, comp, alloc) {}
+
+	multimap& operator=(const multimap& m) {
+		tree = m.tree;
+		return *this;
+	}
+
+	multimap& operator=(multimap&& m) noexcept(noexcept(tree = std::move(m.tree))) {
+		tree = std::move(m.tree);
+		return *this;
+	}
+
+	allocator_type get_allocator() const noexcept { return tree.get_allocator(); }
 
 	key_compare key_comp() const noexcept { return tree.comp; }
 	iterator begin() noexcept { return tree.begin(); }
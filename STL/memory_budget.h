@@ -0,0 +1,232 @@
+#pragma once
+#include "free_list_allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+
+/*
+  byte budget of one subsystem. Containers whose allocator is a
+  budget_allocator bound to the budget charge it for their memory, e.g.
+	memory_budget cache_budget("quote cache", 512 << 20, 768 << 20);
+	cache_budget.set_soft_limit_handler([](memory_budget&) { shed_requested = true; });
+	cx_list<quote, budget_allocator<list_node<quote>>> quotes{
+		budget_allocator<list_node<quote>>(cache_budget)};
+  Every thread adds its charges to one of STRIPE_NUM counters and the
+  budget total is only updated once a counter holds BATCH bytes, so the
+  limits are checked to within STRIPE_NUM * BATCH bytes. Charges of
+  BATCH bytes or more are checked exactly.
+
+  Crossing the soft limit upwards calls the soft limit handler once; it
+  is armed again when the total falls below the limit. A charge over the
+  hard limit calls the hard limit handler until it returns false or the
+  total fits, then fails with std::bad_alloc. Handlers run on the
+  allocating thread in the middle of a container operation: they may free
+  memory of other containers, but the one allocating must be shed by its
+  owner afterwards. Set the handlers before the budget is shared.
+*/
+class memory_budget
+{
+public:
+	static constexpr std::size_t STRIPE_NUM = 16;
+	static constexpr std::int64_t BATCH = 64 * 1024;
+	static constexpr std::size_t NO_LIMIT = std::size_t(-1);
+
+	using soft_handler = std::function<void(memory_budget&)>;
+	//returns whether it freed anything, false makes the charge fail
+	using hard_handler = std::function<bool(memory_budget&)>;
+
+private:
+	struct alignas(CACHE_LINE_SIZE) stripe
+	{
+		std::atomic<std::int64_t> pending{ 0 };
+	};
+
+	stripe stripes[STRIPE_NUM];
+	alignas(CACHE_LINE_SIZE) std::atomic<std::int64_t> charged{ 0 };
+	std::atomic<bool> over_soft_limit{ false };
+	std::size_t soft;
+	std::size_t hard;
+	const char *tag;
+	soft_handler on_soft_limit;
+	hard_handler on_hard_limit;
+
+	static std::size_t local_stripe() noexcept
+	{
+		static std::atomic<std::size_t> next{ 0 };
+		static thread_local std::size_t index =
+			next.fetch_add(1, std::memory_order_relaxed) % STRIPE_NUM;
+		return index;
+	}
+
+	void check_limits(std::int64_t total, std::size_t byte);
+
+public:
+	explicit memory_budget(const char *tag, std::size_t soft_limit = NO_LIMIT,
+						   std::size_t hard_limit = NO_LIMIT) noexcept:
+		soft(soft_limit), hard(hard_limit), tag(tag) {}
+
+	memory_budget(const memory_budget&) = delete;
+	memory_budget& operator=(const memory_budget&) = delete;
+
+	void charge(std::size_t byte);
+	void uncharge(std::size_t byte) noexcept;
+
+	//the total and the charges not yet added to it
+	std::size_t charged_bytes() const noexcept;
+
+	const char *name() const noexcept { return tag; }
+	std::size_t soft_limit() const noexcept { return soft; }
+	std::size_t hard_limit() const noexcept { return hard; }
+
+	void set_soft_limit_handler(soft_handler h) { on_soft_limit = std::move(h); }
+	void set_hard_limit_handler(hard_handler h) { on_hard_limit = std::move(h); }
+};
+
+
+inline void memory_budget::charge(std::size_t byte)
+{
+	std::atomic<std::int64_t>& pending = stripes[local_stripe()].pending;
+	std::int64_t n = static_cast<std::int64_t>(byte);
+	if (pending.fetch_add(n, std::memory_order_relaxed) + n < BATCH) {
+		return;
+	}
+
+	std::int64_t batch = pending.exchange(0, std::memory_order_relaxed);
+	std::int64_t total = charged.fetch_add(batch, std::memory_order_relaxed) + batch;
+	check_limits(total, byte);
+}
+
+
+inline void memory_budget::uncharge(std::size_t byte) noexcept
+{
+	std::atomic<std::int64_t>& pending = stripes[local_stripe()].pending;
+	std::int64_t n = static_cast<std::int64_t>(byte);
+	if (pending.fetch_sub(n, std::memory_order_relaxed) - n > -BATCH) {
+		return;
+	}
+
+	std::int64_t batch = pending.exchange(0, std::memory_order_relaxed);
+	std::int64_t total = charged.fetch_add(batch, std::memory_order_relaxed) + batch;
+	if (total < static_cast<std::int64_t>(soft)) {
+		over_soft_limit.store(false, std::memory_order_relaxed);
+	}
+}
+
+
+inline void memory_budget::check_limits(std::int64_t total, std::size_t byte)
+{
+	if (soft != NO_LIMIT && total >= static_cast<std::int64_t>(soft) &&
+		!over_soft_limit.exchange(true, std::memory_order_relaxed) && on_soft_limit) {
+		on_soft_limit(*this);
+		total = charged.load(std::memory_order_relaxed);
+	}
+
+	while (hard != NO_LIMIT && total > static_cast<std::int64_t>(hard))
+	{
+		if (!on_hard_limit || !on_hard_limit(*this)) {
+			//only the failed charge is taken back, the rest of the batch stands
+			charged.fetch_sub(static_cast<std::int64_t>(byte), std::memory_order_relaxed);
+			throw std::bad_alloc();
+		}
+		total = charged.load(std::memory_order_relaxed);
+	}
+}
+
+
+inline std::size_t memory_budget::charged_bytes() const noexcept
+{
+	std::int64_t total = charged.load(std::memory_order_relaxed);
+	for (const stripe& s : stripes) {
+		total += s.pending.load(std::memory_order_relaxed);
+	}
+
+	return total > 0 ? static_cast<std::size_t>(total) : 0;
+}
+
+
+
+/*
+  charges the budget it is bound to for the memory of Alloc. A default
+  constructed budget_allocator has no budget and charges nothing. The
+  budget travels with the storage on copy, move and swap.
+*/
+template<typename T, typename Alloc = free_list_allocator<T>>
+class budget_allocator
+{
+private:
+	template<typename U, typename A>
+	friend class budget_allocator;
+
+	using alloc_traits = std::allocator_traits<Alloc>;
+
+	memory_budget *budget;
+	Alloc base;
+
+public:
+	typedef T value_type;
+
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+	using is_always_equal = std::false_type;
+
+	//Alloc is rebound along with T
+	template<typename U>
+	struct rebind
+	{
+		using other = budget_allocator<U, typename alloc_traits::template rebind_alloc<U>>;
+	};
+
+	budget_allocator() noexcept: budget(nullptr) {}
+	explicit budget_allocator(memory_budget& budget, const Alloc& base = Alloc()):
+		budget(&budget), base(base) {}
+	template<typename U, typename A>
+	budget_allocator(const budget_allocator<U, A>& other):
+		budget(other.budget), base(other.base) {}
+
+	T *allocate(std::size_t num)
+	{
+		if (budget == nullptr) {
+			return alloc_traits::allocate(base, num);
+		}
+
+		budget->charge(num * sizeof(T));
+		try {
+			return alloc_traits::allocate(base, num);
+		}
+		catch (...) {
+			budget->uncharge(num * sizeof(T));
+			throw;
+		}
+	}
+
+	void deallocate(T *p, std::size_t num) noexcept
+	{
+		alloc_traits::deallocate(base, p, num);
+		if (budget != nullptr) {
+			budget->uncharge(num * sizeof(T));
+		}
+	}
+
+	memory_budget *resource() const noexcept { return budget; }
+	const Alloc& base_allocator() const noexcept { return base; }
+};
+
+
+template<typename T1, typename A1, typename T2, typename A2>
+bool operator==(const budget_allocator<T1, A1>& lhs, const budget_allocator<T2, A2>& rhs)
+{
+	return lhs.resource() == rhs.resource() &&
+		lhs.base_allocator() == rhs.base_allocator();
+}
+
+template<typename T1, typename A1, typename T2, typename A2>
+bool operator!=(const budget_allocator<T1, A1>& lhs, const budget_allocator<T2, A2>& rhs)
+{
+	return !(lhs == rhs);
+}
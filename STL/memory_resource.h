@@ -0,0 +1,397 @@
+#pragma once
+#include "malloc_allocator.h"
+#include "size_class.h"
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+
+/*
+  pmr-style polymorphic memory resources. A container parameterized with
+  polymorphic_allocator<T> keeps one type whatever resource backs it, e.g.
+	pool_resource pool;
+	cx_vector<int, polymorphic_allocator<int>> vec{polymorphic_allocator<int>(&pool)};
+  Every resource takes its memory from an upstream resource, malloc by
+  default, so resources can be chained.
+*/
+class memory_resource
+{
+public:
+	static constexpr std::size_t MAX_ALIGN = alignof(std::max_align_t);
+
+	virtual ~memory_resource() {}
+
+	void *allocate(std::size_t byte, std::size_t align = MAX_ALIGN)
+	{
+		return do_allocate(byte, align);
+	}
+
+	void deallocate(void *p, std::size_t byte,
+					std::size_t align = MAX_ALIGN) noexcept
+	{
+		do_deallocate(p, byte, align);
+	}
+
+	bool is_equal(const memory_resource& other) const noexcept
+	{
+		return this == &other || do_is_equal(other);
+	}
+
+protected:
+	virtual void *do_allocate(std::size_t byte, std::size_t align) = 0;
+	virtual void do_deallocate(void *p, std::size_t byte,
+							   std::size_t align) noexcept = 0;
+	virtual bool do_is_equal(const memory_resource& other) const noexcept = 0;
+};
+
+
+inline bool operator==(const memory_resource& lhs, const memory_resource& rhs)
+{
+	return lhs.is_equal(rhs);
+}
+
+inline bool operator!=(const memory_resource& lhs, const memory_resource& rhs)
+{
+	return !lhs.is_equal(rhs);
+}
+
+
+
+//end of every upstream chain, forwards to malloc_allocator
+class malloc_resource: public memory_resource
+{
+protected:
+	//the aligned calls bypass the heap profiler, resources are not sampled
+	void *do_allocate(std::size_t byte, std::size_t align) override
+	{
+		return malloc_allocator<char>::aligned_allocate(byte, align < MAX_ALIGN ? MAX_ALIGN : align);
+	}
+
+	void do_deallocate(void *p, std::size_t, std::size_t) noexcept override
+	{
+		malloc_allocator<char>::aligned_deallocate(p);
+	}
+
+	bool do_is_equal(const memory_resource& other) const noexcept override
+	{
+		//every malloc_resource hands out the same heap
+		return dynamic_cast<const malloc_resource*>(&other) != nullptr;
+	}
+};
+
+
+inline memory_resource *malloc_memory_resource() noexcept
+{
+	static malloc_resource instance;
+	return &instance;
+}
+
+
+inline std::atomic<memory_resource*>& default_resource_holder() noexcept
+{
+	static std::atomic<memory_resource*> resource(malloc_memory_resource());
+	return resource;
+}
+
+//resource used by default constructed polymorphic_allocators
+inline memory_resource *get_default_resource() noexcept
+{
+	return default_resource_holder().load(std::memory_order_acquire);
+}
+
+//nullptr restores malloc_memory_resource(), returns the previous one
+inline memory_resource *set_default_resource(memory_resource *resource) noexcept
+{
+	if (resource == nullptr) {
+		resource = malloc_memory_resource();
+	}
+	return default_resource_holder().exchange(resource, std::memory_order_acq_rel);
+}
+
+
+
+/*
+  size class pools over an upstream resource, the pooling scheme of
+  free_list_allocator but owned by one instance: each pool_resource has
+  its own free lists and chunks, and release() (or the destructor) gives
+  every chunk back to upstream at once. Requests beyond
+  SizeClass::MAX_BLOCK_SIZE or MAX_ALIGN go to upstream directly.
+  Not thread safe, see synchronized_pool_resource.
+*/
+template<typename SizeClass = geometric_size_classes<>>
+class pool_resource: public memory_resource
+{
+	static_assert(verify_size_classes<SizeClass>(), "bad size class policy");
+
+private:
+	struct obj
+	{
+		obj *next;
+	};
+
+	struct chunk
+	{
+		chunk *next;
+		std::size_t size;   //including the header
+	};
+
+	static constexpr std::size_t CLASS_NUM = SizeClass::CLASS_NUM;
+	static constexpr std::size_t MAX_BLOCK_SIZE = SizeClass::MAX_BLOCK_SIZE;
+	static constexpr std::size_t CHUNK_HEADER_SIZE =
+		(sizeof(chunk) + MAX_ALIGN - 1) & ~(MAX_ALIGN - 1);
+
+	//blocks carved from the pool in one refill
+	static constexpr std::size_t REFILL_BYTE = 4096;
+	static constexpr std::size_t REFILL_MAX = 64;
+
+	obj *free_list[CLASS_NUM] = {};
+	chunk *chunks = nullptr;
+	char *start_pool = nullptr;
+	char *end_pool = nullptr;
+	std::size_t chunk_size;
+	memory_resource *upstream;
+
+	static bool pooled(std::size_t byte, std::size_t align) noexcept
+	{
+		return byte <= MAX_BLOCK_SIZE && align <= MAX_ALIGN;
+	}
+
+	//every class that holds a multiple of align is itself a multiple of align
+	static std::size_t class_index(std::size_t byte, std::size_t align) noexcept
+	{
+		return SizeClass::index((byte + align - 1) & ~(align - 1));
+	}
+
+	//largest power of 2 dividing size, up to MAX_ALIGN
+	static std::size_t block_align(std::size_t size) noexcept
+	{
+		std::size_t align = size & (~size + 1);
+		return align < MAX_ALIGN ? align : MAX_ALIGN;
+	}
+
+	void *refill(std::size_t index);
+	void chunk_alloc(std::size_t byte);
+
+public:
+	static constexpr std::size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+	explicit pool_resource(memory_resource *upstream = malloc_memory_resource(),
+						   std::size_t chunk_size = DEFAULT_CHUNK_SIZE):
+		chunk_size(chunk_size), upstream(upstream) {}
+
+	pool_resource(const pool_resource&) = delete;
+	pool_resource& operator=(const pool_resource&) = delete;
+
+	~pool_resource() { release(); }
+
+	void release() noexcept;
+	memory_resource *upstream_resource() const noexcept { return upstream; }
+
+protected:
+	void *do_allocate(std::size_t byte, std::size_t align) override
+	{
+		if (!pooled(byte, align)) {
+			return upstream->allocate(byte, align);
+		}
+
+		std::size_t index = class_index(byte, align);
+		obj *result = free_list[index];
+		if (result == nullptr) {
+			return refill(index);
+		}
+
+		free_list[index] = result->next;
+		return result;
+	}
+
+	void do_deallocate(void *p, std::size_t byte,
+					   std::size_t align) noexcept override
+	{
+		if (!pooled(byte, align)) {
+			upstream->deallocate(p, byte, align);
+			return;
+		}
+
+		std::size_t index = class_index(byte, align);
+		obj *block = static_cast<obj*>(p);
+		block->next = free_list[index];
+		free_list[index] = block;
+	}
+
+	bool do_is_equal(const memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+
+template<typename SizeClass>
+void *pool_resource<SizeClass>::refill(std::size_t index)
+{
+	std::size_t size = SizeClass::size(index);
+	std::size_t align = block_align(size);
+	std::size_t num = REFILL_BYTE / size;
+	if (num == 0) {
+		num = 1;
+	}
+	else if (num > REFILL_MAX) {
+		num = REFILL_MAX;
+	}
+
+	char *start = reinterpret_cast<char*>(
+		(reinterpret_cast<std::uintptr_t>(start_pool) + align - 1) & ~(align - 1));
+	if (start_pool == nullptr || start > end_pool ||
+		std::size_t(end_pool - start) < size) {
+		//what is left of the old chunk is abandoned, less than one block
+		chunk_alloc(size * num);
+		start = start_pool;
+	}
+
+	std::size_t left = (end_pool - start) / size;
+	if (num > left) {
+		num = left;
+	}
+
+	//the first block is returned, the others go into the free list
+	obj *result = reinterpret_cast<obj*>(start);
+	for (std::size_t i = num - 1; i > 0; --i)
+	{
+		obj *block = reinterpret_cast<obj*>(start + i * size);
+		block->next = free_list[index];
+		free_list[index] = block;
+	}
+
+	start_pool = start + num * size;
+	return result;
+}
+
+
+template<typename SizeClass>
+void pool_resource<SizeClass>::chunk_alloc(std::size_t byte)
+{
+	std::size_t size = CHUNK_HEADER_SIZE + byte;
+	if (size < chunk_size) {
+		size = chunk_size;
+	}
+
+	chunk *new_chunk = static_cast<chunk*>(upstream->allocate(size, MAX_ALIGN));
+	new_chunk->next = chunks;
+	new_chunk->size = size;
+	chunks = new_chunk;
+
+	start_pool = reinterpret_cast<char*>(new_chunk) + CHUNK_HEADER_SIZE;
+	end_pool = reinterpret_cast<char*>(new_chunk) + size;
+}
+
+
+template<typename SizeClass>
+void pool_resource<SizeClass>::release() noexcept
+{
+	while (chunks != nullptr)
+	{
+		chunk *next = chunks->next;
+		upstream->deallocate(chunks, chunks->size, MAX_ALIGN);
+		chunks = next;
+	}
+
+	for (std::size_t i = 0; i < CLASS_NUM; ++i) {
+		free_list[i] = nullptr;
+	}
+	start_pool = nullptr;
+	end_pool = nullptr;
+}
+
+
+
+//pool_resource shared between threads, one lock per call
+template<typename SizeClass = geometric_size_classes<>>
+class synchronized_pool_resource: public pool_resource<SizeClass>
+{
+private:
+	using base = pool_resource<SizeClass>;
+
+	std::mutex mutex;
+
+public:
+	using base::base;
+
+	void release() noexcept
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		base::release();
+	}
+
+protected:
+	void *do_allocate(std::size_t byte, std::size_t align) override
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return base::do_allocate(byte, align);
+	}
+
+	void do_deallocate(void *p, std::size_t byte,
+					   std::size_t align) noexcept override
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		base::do_deallocate(p, byte, align);
+	}
+};
+
+
+
+/*
+  allocator over a memory_resource*, the resource is chosen at run time.
+  Like std::pmr::polymorphic_allocator it never propagates: a container
+  keeps its resource for life and a copy uses the default resource.
+*/
+template<typename T>
+class polymorphic_allocator
+{
+private:
+	memory_resource *res;
+
+public:
+	typedef T value_type;
+
+	polymorphic_allocator() noexcept: res(get_default_resource()) {}
+	polymorphic_allocator(memory_resource *resource) noexcept: res(resource) {}
+	template<typename U>
+	polymorphic_allocator(const polymorphic_allocator<U>& other) noexcept:
+		res(other.resource()) {}
+
+	T *allocate(std::size_t num)
+	{
+		if (num > std::size_t(-1) / sizeof(T)) {
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(res->allocate(num * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T *p, std::size_t num) noexcept
+	{
+		res->deallocate(p, num * sizeof(T), alignof(T));
+	}
+
+	polymorphic_allocator select_on_container_copy_construction() const noexcept
+	{
+		return polymorphic_allocator();
+	}
+
+	memory_resource *resource() const noexcept { return res; }
+};
+
+
+template<typename T1, typename T2>
+bool operator==(const polymorphic_allocator<T1>& lhs,
+				const polymorphic_allocator<T2>& rhs) noexcept
+{
+	return *lhs.resource() == *rhs.resource();
+}
+
+template<typename T1, typename T2>
+bool operator!=(const polymorphic_allocator<T1>& lhs,
+				const polymorphic_allocator<T2>& rhs) noexcept
+{
+	return !(lhs == rhs);
+}
@@ -0,0 +1,187 @@
+#pragma once
+#include "malloc_allocator.h"
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#ifdef MREMAP_MAYMOVE
+#define CX_HAS_MREMAP
+#endif
+#endif
+
+
+/*
+  allocator for very large buffers of trivially relocatable elements, e.g.
+	cx_vector<record, mremap_allocator<record>> records;
+  Blocks of MAP_THRESHOLD bytes or more are mapped from the system and
+  reallocate grows them with mremap(MREMAP_MAYMOVE), which moves page
+  table entries instead of copying the bytes, so growing a mapped block
+  costs the same whatever its size. Smaller blocks come from malloc and
+  cross into a mapping once, when they grow past the threshold.
+  Where there is no mremap (Windows, macOS) every block is malloc's.
+
+  reallocate moves the bytes of the block, so it may only be used for
+  trivially relocatable types; cx_vector checks that before calling it.
+*/
+template<typename T>
+class mremap_allocator
+{
+public:
+	typedef T value_type;
+
+	static constexpr std::size_t MAP_THRESHOLD = 1024 * 1024;
+
+private:
+	static constexpr std::size_t PAGE_BYTES = 4096;
+
+#ifdef CX_HAS_MREMAP
+	static constexpr bool MAPPABLE = alignof(T) <= PAGE_BYTES;
+#else
+	static constexpr bool MAPPABLE = false;
+#endif
+
+	static bool mapped(std::size_t num) noexcept {
+		return MAPPABLE && num * sizeof(T) >= MAP_THRESHOLD;
+	}
+
+	static std::size_t map_bytes(std::size_t num) noexcept {
+		return (num * sizeof(T) + PAGE_BYTES - 1) & ~(PAGE_BYTES - 1);
+	}
+
+	static T *map(std::size_t num);
+	static void unmap(T *p, std::size_t num) noexcept;
+	static T *remap(T *p, std::size_t old_num, std::size_t num);
+
+public:
+	mremap_allocator() {}
+	template<typename U>
+	mremap_allocator(const mremap_allocator<U>&) {
+		//no state to copy
+	}
+
+	static T *allocate(std::size_t num);
+	static void deallocate(T *p, std::size_t num) noexcept;
+	//grows or shrinks a block of old_num elements, the elements move bytewise
+	static T *reallocate(T *p, std::size_t old_num, std::size_t num);
+};
+
+
+template<typename T>
+T *mremap_allocator<T>::allocate(std::size_t num)
+{
+	if (mapped(num)) {
+		T *result = map(num);
+		heap_profile::on_allocate<T>(result, num * sizeof(T));
+		return result;
+	}
+	return malloc_allocator<T>::allocate(num);
+}
+
+
+template<typename T>
+void mremap_allocator<T>::deallocate(T *p, std::size_t num) noexcept
+{
+	if (mapped(num)) {
+		heap_profile::on_deallocate(p);
+		unmap(p, num);
+		return;
+	}
+	malloc_allocator<T>::deallocate(p, num);
+}
+
+
+template<typename T>
+T *mremap_allocator<T>::reallocate(T *p, std::size_t old_num, std::size_t num)
+{
+	if (mapped(old_num) && mapped(num)) {
+		//mremap may unmap p, its sample is taken out first
+		heap_profile::reallocation profile(p);
+		T *result = remap(p, old_num, num);
+		profile.done<T>(result, num * sizeof(T));
+		return result;
+	}
+	if (!mapped(old_num) && !mapped(num)) {
+		return malloc_allocator<T>::reallocate(p, old_num, num);
+	}
+
+	//the block crosses the threshold and changes hands
+	T *result = allocate(num);
+	std::size_t n = std::min(old_num, num);
+	if (n != 0) {
+		std::memcpy(static_cast<void*>(result), static_cast<const void*>(p), n * sizeof(T));
+	}
+	deallocate(p, old_num);
+	return result;
+}
+
+
+#ifdef CX_HAS_MREMAP
+
+template<typename T>
+T *mremap_allocator<T>::map(std::size_t num)
+{
+	void *result = mmap(nullptr, map_bytes(num), PROT_READ | PROT_WRITE,
+						MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (result == MAP_FAILED) {
+		throw std::bad_alloc();
+	}
+	return static_cast<T*>(result);
+}
+
+
+template<typename T>
+void mremap_allocator<T>::unmap(T *p, std::size_t num) noexcept
+{
+	munmap(p, map_bytes(num));
+}
+
+
+template<typename T>
+T *mremap_allocator<T>::remap(T *p, std::size_t old_num, std::size_t num)
+{
+	void *result = mremap(p, map_bytes(old_num), map_bytes(num), MREMAP_MAYMOVE);
+	if (result == MAP_FAILED) {
+		throw std::bad_alloc();
+	}
+	return static_cast<T*>(result);
+}
+
+#else
+
+//never called, no block is mapped
+template<typename T>
+T *mremap_allocator<T>::map(std::size_t num)
+{
+	return malloc_allocator<T>::allocate(num);
+}
+
+template<typename T>
+void mremap_allocator<T>::unmap(T *p, std::size_t num) noexcept
+{
+	malloc_allocator<T>::deallocate(p, num);
+}
+
+template<typename T>
+T *mremap_allocator<T>::remap(T *p, std::size_t old_num, std::size_t num)
+{
+	return malloc_allocator<T>::reallocate(p, old_num, num);
+}
+
+#endif
+
+
+template<typename T1, typename T2>
+bool operator==(const mremap_allocator<T1>&, const mremap_allocator<T2>&)
+{
+	return true;
+}
+
+
+template<typename T1, typename T2>
+bool operator!=(const mremap_allocator<T1>&, const mremap_allocator<T2>&)
+{
+	return false;
+}
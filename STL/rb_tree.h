@@ -2,6 +2,8 @@
 #include "iterator.h"
 #include <assert.h>
 #include "free_list_allocator.h"
+#include "alloc_batch.h"
+#include <memory>
 
 
 namespace cx {
@@ -295,8 +297,10 @@ public:
 	using allocator_type = typename Traits::allocator_type;
 	using reference = value_type&;
 	using const_reference = const value_type&;
-	using pointer = value_type*; //fix me: use allocator_traits instead
-	using const_pointer = const value_type*;
+	using pointer = typename std::allocator_traits<allocator_type>::
+		template rebind_traits<value_type>::pointer;
+	using const_pointer = typename std::allocator_traits<allocator_type>::
+		template rebind_traits<value_type>::const_pointer;
 	using iterator = typename Traits::iterator;
 	using const_iterator = typename Traits::const_iterator;
 	using difference_type = typename iterator_traits<iterator>::difference_type;
@@ -306,13 +310,20 @@ public:
 protected:
 	using key_extractor = typename Traits::key_extractor;
 	using mut_iterator = rb_tree_iterator<value_type>;
+	using node_allocator_type = typename std::allocator_traits<allocator_type>::
+		template rebind_alloc<rb_tree_node<value_type>>;
+	using alloc_traits = std::allocator_traits<node_allocator_type>;
+	using node_batch = alloc::node_batch<node_allocator_type>;
+	using node_release = alloc::node_release<node_allocator_type>;
 	enum class side { left, right, parent };
 
 protected:
+	node_allocator_type node_allocator;
 	size_type node_count;
 	mut_iterator header;
 	key_compare comp;
 	key_extractor extractor;
+	node_batch *batch = nullptr;    //Ϊʱcreate_nodeȡýڵ
 
 	mut_iterator create_node(color_type color);
 	mut_iterator create_node(const value_type& val, color_type color) {
@@ -322,6 +333,7 @@ protected:
 		return aux_create_node(std::move(val), color);
 	}
 	void destroy_node(mut_iterator iter) noexcept;
+	void deallocate_node(mut_iterator iter) noexcept;   //headernilڵûvalue
 	mut_iterator root() const noexcept { return header->parent; }
 	mut_iterator min() const noexcept { return header->left; }
 	mut_iterator max() const noexcept { return header->right; }
@@ -334,7 +346,20 @@ protected:
 
 private:
 	void init();
-	void destruct(mut_iterator iter) noexcept;
+	void destruct(mut_iterator iter, node_release& release) noexcept;
+	template<typename InputIterator>
+	void insert_range(InputIterator first, InputIterator last, size_type n);
+	template<typename InputIterator>
+	static size_type range_size(InputIterator first, InputIterator last,
+								std::input_iterator_tag) {
+		return 0;
+	}
+	template<typename ForwardIterator>
+	static size_type range_size(ForwardIterator first, ForwardIterator last,
+								std::forward_iterator_tag) {
+		return std::distance(first, last);
+	}
+	void swap_storage(rb_tree& tree) noexcept;
 	mut_iterator aux_find(const key_type& key) const;
 
 	template<typename T>
@@ -358,46 +383,58 @@ private:
 	
 
 public:
-	explicit rb_tree(const key_compare& comp = key_compare()): comp(comp), 
-					 node_count(0) {
+	explicit rb_tree(const key_compare& comp = key_compare(),
+					 const allocator_type& alloc = allocator_type()):
+		node_allocator(alloc), comp(comp), node_count(0) {
 		init();
 	}
 
+	explicit rb_tree(const allocator_type& alloc):
+		rb_tree(key_compare(), alloc) {}
+
 	template<typename InputIterator>
 	rb_tree(InputIterator first, InputIterator last,
-			const key_compare& comp = key_compare());
+			const key_compare& comp = key_compare(),
+			const allocator_type& alloc = allocator_type());
 
-	rb_tree(const rb_tree<Traits>& t);
+	rb_tree(const rb_tree& t);
+	rb_tree(const rb_tree& t, const allocator_type& alloc);
 
-	rb_tree(rb_tree<Traits>&& t) noexcept: 
+	rb_tree(rb_tree&& t) noexcept: 
+		node_allocator(std::move(t.node_allocator)),
 		node_count(t.node_count), header(t.header), 
 		comp(t.comp){
 		t.node_count = 0;
 		t.header.clear();
 	}
 
+	rb_tree(rb_tree&& t, const allocator_type& alloc);
+
 	rb_tree(std::initializer_list<value_type> l,
-		const key_compare& comp = key_compare()) : 
-		comp(comp), node_count(0) {
+		const key_compare& comp = key_compare(),
+		const allocator_type& alloc = allocator_type()) : 
+		node_allocator(alloc), comp(comp), node_count(0) {
 		init();
-		for (auto iter = l.begin(); iter != l.end(); ++iter) {
-			if (Traits::MULTI) {
-				insert_equal(*iter);
-			}
-			else {
-				insert_unique(*iter);
-			}
-		}
+		insert_range(l.begin(), l.end(), l.size());
 	}
 
 	~rb_tree(){
 		//ĬΪnoexcept
 		if (header.is_not_null()) {
-			destruct(root());
-			destroy_node(header);
+			clear();
+			deallocate_node(header);
 		}
 	}
 
+	rb_tree& operator=(const rb_tree& t);
+	rb_tree& operator=(rb_tree&& t) noexcept(
+		alloc_traits::propagate_on_container_move_assignment::value ||
+		alloc_traits::is_always_equal::value);
+
+	allocator_type get_allocator() const noexcept {
+		return allocator_type(node_allocator);
+	}
+
 	key_compare key_comp() const noexcept { return comp; }
 	iterator begin() noexcept { return header->left; }
 	const_iterator begin() const noexcept { return header->left; }
@@ -408,7 +445,8 @@ public:
 	bool empty() const noexcept { return node_count == 0; }
 	size_type size() const noexcept { return node_count; }
 	void clear() noexcept {
-		destruct(root());
+		node_release release(node_allocator);
+		destruct(root(), release);
 		header->left = header;
 		header->right = header;
 		header->parent.clear();
@@ -464,9 +502,11 @@ public:
 
 	iterator erase(const_iterator iter) noexcept;
 
-	void swap(rb_tree<Traits>& tree) noexcept{
-		std::swap(node_count, tree.node_count);
-		std::swap(header, tree.header);
+	void swap(rb_tree& tree) noexcept{
+		if (alloc_traits::propagate_on_container_swap::value) {
+			std::swap(node_allocator, tree.node_allocator);
+		}
+		swap_storage(tree);
 	}
 
 };
@@ -477,7 +517,7 @@ template<typename Traits>
 typename rb_tree<Traits>::mut_iterator
 rb_tree<Traits>::create_node(color_type color)
 {
-	mut_iterator iter(allocator_type::allocate(1));
+	mut_iterator iter(batch != nullptr ? batch->get() : node_allocator.allocate(1));
 	iter->color = color;
 	iter->left.clear();
 	iter->right.clear();
@@ -491,8 +531,19 @@ template<typename T>
 typename rb_tree<Traits>::mut_iterator
 rb_tree<Traits>::aux_create_node(T&& val, color_type color)
 {
-	mut_iterator iter(allocator_type::allocate(1));
-	alloc::construct(&(iter->value), std::forward<T>(val));
+	mut_iterator iter(batch != nullptr ? batch->get() : node_allocator.allocate(1));
+	try {
+		alloc::construct(&(iter->value), std::forward<T>(val));
+	}
+	catch (...) {
+		if (batch != nullptr) {
+			batch->unget(iter.get_ptr());
+		}
+		else {
+			deallocate_node(iter);
+		}
+		throw;
+	}
 	iter->color = color;
 	iter->left.clear();
 	iter->right.clear();
@@ -505,23 +556,67 @@ template<typename Traits>
 void rb_tree<Traits>::destroy_node(mut_iterator iter) noexcept
 {
 	alloc::destroy(&(iter->value));
-	allocator_type::deallocate(iter.get_ptr(), 1);
+	node_allocator.deallocate(iter.get_ptr(), 1);
 }
 
 
 template<typename Traits>
-void cx::rb_tree<Traits>::destruct(mut_iterator iter) noexcept
+void rb_tree<Traits>::deallocate_node(mut_iterator iter) noexcept
+{
+	node_allocator.deallocate(iter.get_ptr(), 1);
+}
+
+
+template<typename Traits>
+void rb_tree<Traits>::swap_storage(rb_tree& tree) noexcept
+{
+	std::swap(node_count, tree.node_count);
+	std::swap(header, tree.header);
+	std::swap(comp, tree.comp);
+}
+
+
+template<typename Traits>
+void cx::rb_tree<Traits>::destruct(mut_iterator iter,
+								   node_release& release) noexcept
 {
 	if (iter.is_null())
 		return;
 
-	destruct(iter->left);
-	destruct(iter->right);
-	destroy_node(iter);
+	destruct(iter->left, release);
+	destruct(iter->right, release);
+	alloc::destroy(&(iter->value));
+	release.put(iter.get_ptr());
 	--node_count;
 }
 
 
+//nΪԪظԤֵڵ㰴˳
+template<typename Traits>
+template<typename InputIterator>
+void rb_tree<Traits>::insert_range(InputIterator first, InputIterator last,
+								   size_type n)
+{
+	node_batch nodes(node_allocator, n);
+	batch = &nodes;
+	try {
+		for (auto iter = first; iter != last; ++iter) {
+			if (Traits::MULTI) {
+				insert_equal(*iter);
+			}
+			else {
+				insert_unique(*iter);
+			}
+		}
+	}
+	catch (...) {
+		batch = nullptr;
+		throw;
+	}
+	batch = nullptr;
+}
+
+
 template<typename Traits>
 void rb_tree<Traits>::init()
 {
@@ -535,36 +630,96 @@ void rb_tree<Traits>::init()
 template<typename Traits>
 template<typename InputIterator>
 rb_tree<Traits>::rb_tree(InputIterator first, InputIterator last,
-	const key_compare& comp): node_count(0), comp(comp)
+	const key_compare& comp, const allocator_type& alloc):
+	node_allocator(alloc), node_count(0), comp(comp)
 {
 	init();
-	for (auto iter = first; iter != last; ++iter) {
-		if (Traits::MULTI) {
-			insert_equal(*iter);
-		}
-		else {
-			insert_unique(*iter);
-		}
-	}
+	insert_range(first, last, range_size(first, last,
+		typename std::iterator_traits<InputIterator>::iterator_category()));
 }
 
 
 template<typename Traits>
-rb_tree<Traits>::rb_tree(const rb_tree<Traits>& t): 
-	node_count(0), comp(t.comp)
+rb_tree<Traits>::rb_tree(const rb_tree& t):
+	rb_tree(t, allocator_type(alloc_traits::
+		select_on_container_copy_construction(t.node_allocator))) {}
+
+
+template<typename Traits>
+rb_tree<Traits>::rb_tree(const rb_tree& t, const allocator_type& alloc): 
+	node_allocator(alloc), node_count(0), comp(t.comp)
 {
 	init();
-	for (auto iter = t.cbegin(); iter != t.cend(); ++iter) {
+	insert_range(t.cbegin(), t.cend(), t.size());
+}
+
+
+template<typename Traits>
+rb_tree<Traits>::rb_tree(rb_tree&& t, const allocator_type& alloc):
+	node_allocator(alloc), node_count(0), comp(t.comp)
+{
+	if (node_allocator == t.node_allocator) {
+		node_count = t.node_count;
+		header = t.header;
+		t.node_count = 0;
+		t.header.clear();
+		return;
+	}
+
+	//ڵһֻƶԪ
+	init();
+	for (auto iter = t.begin(); iter != t.end(); ++iter) {
+		value_type& val = const_cast<value_type&>(*iter);
 		if (Traits::MULTI) {
-			insert_equal(*iter);
+			insert_equal(std::move(val));
 		}
 		else {
-			insert_unique(*iter);
+			insert_unique(std::move(val));
 		}
 	}
 }
 
 
+template<typename Traits>
+rb_tree<Traits>& rb_tree<Traits>::operator=(const rb_tree& t)
+{
+	if (this == &t)
+		return *this;
+
+	//ɽڵɵķһ𽻸tmpͷ
+	if (alloc_traits::propagate_on_container_copy_assignment::value) {
+		rb_tree tmp(t, t.get_allocator());
+		std::swap(node_allocator, tmp.node_allocator);
+		swap_storage(tmp);
+	}
+	else {
+		rb_tree tmp(t, get_allocator());
+		swap_storage(tmp);
+	}
+	return *this;
+}
+
+
+template<typename Traits>
+rb_tree<Traits>& rb_tree<Traits>::operator=(rb_tree&& t) noexcept(
+	alloc_traits::propagate_on_container_move_assignment::value ||
+	alloc_traits::is_always_equal::value)
+{
+	if (alloc_traits::propagate_on_container_move_assignment::value) {
+		std::swap(node_allocator, t.node_allocator);
+		swap_storage(t);
+	}
+	else if (node_allocator == t.node_allocator) {
+		swap_storage(t);
+	}
+	else {
+		rb_tree tmp(std::move(t), get_allocator());
+		swap_storage(tmp);
+	}
+	return *this;
+}
+
+
 template<typename Traits>
 typename rb_tree<Traits>::mut_iterator
 rb_tree<Traits>::min(mut_iterator iter) const noexcept
@@ -984,7 +1139,7 @@ rb_tree<Traits>::erase(const_iterator iter) noexcept
 	}
 	if (nil_flag) {
 		transplant(x, mut_iterator());
-		destroy_node(x);
+		deallocate_node(x);
 	}
 
 	destroy_node(z);
@@ -1,11 +1,11 @@
 #pragma once
-#include "free_list_allocator.h"
+#include "slab_allocator.h"
 #include "rb_tree.h"
 
 namespace cx
 {
 template<typename T, typename Compare = std::less<T>, 
-		 typename Alloc = free_list_allocator<rb_tree_node<T>>>
+		 typename Alloc = slab_allocator<rb_tree_node<T>>>
 class set
 {
 protected:
@@ -28,19 +28,42 @@ public:
 	using size_type = typename rb_tree_t::size_type;
 
 public:
-	explicit set(const key_compare& comp = key_compare()): tree(comp) {}
+	explicit set(const key_compare& comp = key_compare(),
+		const allocator_type& alloc = allocator_type()): tree(comp, alloc) {}
+
+	explicit set(const allocator_type& alloc): tree(alloc) {}
 
 	template<typename InputIterator>
 	set(InputIterator first, InputIterator last,
-		const key_compare& comp = key_compare()): tree(first, last, comp){}
+		const key_compare& comp = key_compare(),
+		const allocator_type& alloc = allocator_type()):
+		tree(first, last, comp, alloc) {}
 
 	set(const set& s): tree(s.tree) {}
 
+	set(const set& s, const allocator_type& alloc): tree(s.tree, alloc) {}
+
 	set(set&& s) noexcept : tree(std::move(s.tree)) {}
 
+	set(set&& s, const allocator_type& alloc):
+		tree(std::move(s.tree), alloc) {}
+
 	set(std::initializer_list<value_type> l,
-		const key_compare& comp = key_compare()) :
-		tree(l, comp) {}
+		const key_compare& comp = key_compare(),
+		const allocator_type& alloc = allocator_type()):
+		tree(l, comp, alloc) {}
+
+	set& operator=(const set& s) {
+		tree = s.tree;
+		return *this;
+	}
+
+	set& operator=(set&& s) noexcept(noexcept(tree = std::move(s.tree))) {
+		tree = std::move(s.tree);
+		return *this;
+	}
+
+	allocator_type get_allocator() const noexcept { return tree.get_allocator(); }
 
 	key_compare key_comp() const noexcept { return tree.comp; }
 	iterator begin() noexcept { return tree.begin(); }
@@ -106,7 +129,7 @@ public:
 
 
 template<typename T, typename Compare = std::less<T>,
-		 typename Alloc = free_list_allocator<rb_tree_node<T>>>
+		 typename Alloc = slab_allocator<rb_tree_node<T>>>
 class multiset
 {
 protected:
@@ -129,19 +152,42 @@ public:
 	using size_type = typename rb_tree_t::size_type;
 
 public:
-	explicit multiset(const key_compare& comp = key_compare()) : tree(comp) {}
+	explicit multiset(const key_compare& comp = key_compare(),
+		const allocator_type& alloc = allocator_type()) : tree(comp, alloc) {}
+
+	explicit multiset(const allocator_type& alloc) : tree(alloc) {}
 
 	template<typename InputIterator>
 	multiset(InputIterator first, InputIterator last,
-		const key_compare& comp = key_compare()) : tree(first, last, comp) {}
+		const key_compare& comp = key_compare(),
+		const allocator_type& alloc = allocator_type()) :
+		tree(first, last, comp, alloc) {}
 
 	multiset(const multiset& s) : tree(s.tree) {}
 
+	multiset(const multiset& s, const allocator_type& alloc) : tree(s.tree, alloc) {}
+
 	multiset(multiset&& s) noexcept : tree(std::move(s.tree)) {}
 
+	multiset(multiset&& s, const allocator_type& alloc) :
+		tree(std::move(s.tree), alloc) {}
+
 	multiset(std::initializer_list<value_type> l,
-		const key_compare& comp = key_compare()) :
-		tree(l, comp) {}
+		const key_compare& comp = key_compare(),
+		const allocator_type& alloc = allocator_type()) :
+		tree(l, comp, alloc) {}
+
+	multiset& operator=(const multiset& s) {
+		tree = s.tree;
+		return *this;
+	}
+
+	multiset& operator=(multiset&& s) noexcept(noexcept(tree = std::move(s.tree))) {
+		tree = std::move(s.tree);
+		return *this;
+	}
+
+	allocator_type get_allocator() const noexcept { return tree.get_allocator(); }
 
 	key_compare key_comp() const noexcept { return tree.comp; }
 	iterator begin() noexcept { return tree.begin(); }
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstddef>
+
+/*
+  size class policies for free_list_allocator. A policy maps a request of
+  byte (0 <= byte <= MAX_BLOCK_SIZE) to the smallest class that holds it:
+
+	static constexpr std::size_t ALIGN;             smallest class / spacing
+	static constexpr std::size_t MAX_BLOCK_SIZE;    larger requests use malloc
+	static constexpr std::size_t CLASS_NUM;
+	static constexpr std::size_t index(std::size_t byte);
+	static constexpr std::size_t size(std::size_t index);
+*/
+
+
+//one class every Align bytes
+template<std::size_t Align = 8, std::size_t MaxBlockSize = 128>
+struct linear_size_classes
+{
+	static_assert((Align & (Align - 1)) == 0, "Align must be a power of 2");
+	static_assert(MaxBlockSize % Align == 0,
+				  "MaxBlockSize must be a multiple of Align");
+
+	static constexpr std::size_t ALIGN = Align;
+	static constexpr std::size_t MAX_BLOCK_SIZE = MaxBlockSize;
+	static constexpr std::size_t CLASS_NUM = MaxBlockSize / Align;
+
+	static constexpr std::size_t index(std::size_t byte) noexcept
+	{
+		return byte == 0 ? 0 : (byte + ALIGN - 1) / ALIGN - 1;
+	}
+
+	static constexpr std::size_t size(std::size_t index) noexcept
+	{
+		return (index + 1) * ALIGN;
+	}
+};
+
+
+/*
+  jemalloc-like spacing: 8 byte steps up to 128, then four classes per
+  doubling (160, 192, 224, 256, 320, ...). A class that holds a multiple
+  of some power of 2 no larger than the step is itself a multiple of it,
+  so blocks keep the alignment of their element type.
+*/
+template<std::size_t MaxBlockSize = 1024>
+struct geometric_size_classes
+{
+private:
+	static constexpr std::size_t LINEAR_MAX = 128;
+	static constexpr std::size_t LINEAR_NUM = LINEAR_MAX / 8;
+	static constexpr std::size_t CLASS_PER_GROUP = 4;
+
+	//floor(log2(n))
+	static constexpr std::size_t log2(std::size_t n) noexcept
+	{
+		std::size_t result = 0;
+		while (n >>= 1) {
+			++result;
+		}
+		return result;
+	}
+
+public:
+	static_assert(MaxBlockSize >= LINEAR_MAX &&
+				  (MaxBlockSize & (MaxBlockSize - 1)) == 0,
+				  "MaxBlockSize must be a power of 2 no less than 128");
+
+	static constexpr std::size_t ALIGN = 8;
+	static constexpr std::size_t MAX_BLOCK_SIZE = MaxBlockSize;
+	static constexpr std::size_t CLASS_NUM = LINEAR_NUM +
+		CLASS_PER_GROUP * (log2(MaxBlockSize) - log2(LINEAR_MAX));
+
+	static constexpr std::size_t index(std::size_t byte) noexcept
+	{
+		if (byte <= LINEAR_MAX) {
+			return byte == 0 ? 0 : (byte + ALIGN - 1) / ALIGN - 1;
+		}
+
+		//2^group < byte <= 2^(group + 1)
+		std::size_t group = log2(byte - 1);
+		std::size_t step = (std::size_t(1) << group) / CLASS_PER_GROUP;
+		return LINEAR_NUM + (group - log2(LINEAR_MAX)) * CLASS_PER_GROUP +
+			(byte - (std::size_t(1) << group) - 1) / step;
+	}
+
+	static constexpr std::size_t size(std::size_t index) noexcept
+	{
+		if (index < LINEAR_NUM) {
+			return (index + 1) * ALIGN;
+		}
+
+		std::size_t base = LINEAR_MAX << ((index - LINEAR_NUM) / CLASS_PER_GROUP);
+		return base + base / CLASS_PER_GROUP *
+			((index - LINEAR_NUM) % CLASS_PER_GROUP + 1);
+	}
+};
+
+
+//every size must map to the smallest class that holds it
+template<typename SizeClass>
+constexpr bool verify_size_classes() noexcept
+{
+	if (SizeClass::size(SizeClass::CLASS_NUM - 1) != SizeClass::MAX_BLOCK_SIZE) {
+		return false;
+	}
+
+	for (std::size_t i = 0; i < SizeClass::CLASS_NUM; ++i)
+	{
+		if (SizeClass::size(i) % SizeClass::ALIGN != 0 ||
+			SizeClass::index(SizeClass::size(i)) != i ||
+			(i > 0 && SizeClass::size(i - 1) >= SizeClass::size(i))) {
+			return false;
+		}
+	}
+
+	for (std::size_t byte = 1; byte <= SizeClass::MAX_BLOCK_SIZE; ++byte)
+	{
+		std::size_t i = SizeClass::index(byte);
+		if (i >= SizeClass::CLASS_NUM || SizeClass::size(i) < byte ||
+			(i > 0 && SizeClass::size(i - 1) >= byte)) {
+			return false;
+		}
+	}
+
+	return true;
+}
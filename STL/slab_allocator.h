@@ -0,0 +1,522 @@
+#pragma once
+#include "free_list_allocator.h"
+#include "bit_util.h"
+#include "alloc_trace.h"
+#include "heap_profile.h"
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+
+
+/*
+  slab allocator for a single node type such as list_node<T> or
+  rb_tree_node<V>. Nodes are packed at their exact size into page sized
+  slabs and every slab keeps a bitmap of its free slots. Successive slabs
+  start their nodes at different cache line offsets (colors), so the
+  first nodes of many slabs do not compete for the same cache sets.
+  Slabs belong to the thread that created them; a node freed by another
+  thread is queued back to that thread, as in free_list_allocator.
+  Only single nodes are pooled, arrays go to ChunkSource directly.
+*/
+template<typename T, typename ChunkSource = malloc_chunk_source>
+class slab_allocator
+{
+private:
+	static constexpr std::size_t NODE_ALIGN =
+		alignof(T) > alignof(void*) ? alignof(T) : alignof(void*);
+	//a free node has to hold the link of the remote free list
+	static constexpr std::size_t NODE_SIZE =
+		((sizeof(T) > sizeof(void*) ? sizeof(T) : sizeof(void*)) +
+		 NODE_ALIGN - 1) & ~(NODE_ALIGN - 1);
+	static constexpr std::size_t COLOR_STEP =
+		NODE_ALIGN > CACHE_LINE_SIZE ? NODE_ALIGN : CACHE_LINE_SIZE;
+
+	//a page of ChunkSource, or the smallest power of 2 that still holds 16 nodes
+	static constexpr std::size_t slab_size() noexcept
+	{
+		std::size_t size = ChunkSource::PAGE_BYTES;
+		while (size < 16 * NODE_SIZE + 512) {
+			size *= 2;
+		}
+		return size;
+	}
+
+	static constexpr std::size_t SLAB_SIZE = slab_size();
+	static constexpr std::size_t BITMAP_WORDS = (SLAB_SIZE / NODE_SIZE + 63) / 64;
+
+	struct node
+	{
+		node *next;
+	};
+
+	struct thread_cache;
+
+	struct slab
+	{
+		thread_cache *owner;
+		slab *prev;             //owner's partial list or the free slabs
+		slab *next;
+		char *first;            //first node, after the header and the color
+		std::size_t free_num;
+		std::size_t hint;       //no free slot below this bitmap word
+		std::uint64_t bitmap[BITMAP_WORDS];   //1 for a free slot
+	};
+
+	static constexpr std::size_t HEADER_SIZE =
+		(sizeof(slab) + NODE_ALIGN - 1) & ~(NODE_ALIGN - 1);
+	static constexpr std::size_t CAPACITY = (SLAB_SIZE - HEADER_SIZE) / NODE_SIZE;
+	static constexpr std::size_t COLORS =
+		(SLAB_SIZE - HEADER_SIZE - CAPACITY * NODE_SIZE) / COLOR_STEP + 1;
+
+	struct thread_cache
+	{
+		slab *current = nullptr;
+		slab *partial = nullptr;   //other owned slabs with free slots
+		std::atomic<node*> remote_free{ nullptr };
+		std::size_t next_color = 0;
+		thread_cache *next = nullptr;
+		bool retired = false;      //the thread has exited, may be adopted
+	};
+
+	struct cache_handle
+	{
+		thread_cache *cache = nullptr;
+
+		~cache_handle() noexcept;
+		thread_cache *get();
+	};
+
+	static std::mutex pool_mutex;
+	static slab *free_slabs;       //guarded by pool_mutex
+	static std::size_t slab_num;
+	static thread_cache *caches;
+	static thread_local cache_handle local_cache;
+
+
+	static slab *slab_of(void *p) noexcept
+	{
+		return reinterpret_cast<slab*>(
+			reinterpret_cast<std::uintptr_t>(p) & ~(SLAB_SIZE - 1));
+	}
+
+	static T *alloc_node(thread_cache *cache);
+	static slab *refill(thread_cache *cache);
+	static slab *slab_alloc(thread_cache *cache);
+	static void slab_free(slab *s) noexcept;
+
+	static void free_local(thread_cache *cache, slab *s, void *p) noexcept;
+	static void free_remote(thread_cache *owner, void *p) noexcept;
+	static void collect_remote(thread_cache *cache) noexcept;
+	static void release_empty(thread_cache *cache) noexcept;
+
+	static void link_partial(thread_cache *cache, slab *s) noexcept;
+	static void unlink_partial(thread_cache *cache, slab *s) noexcept;
+
+
+public:
+	typedef T value_type;
+
+	slab_allocator() {}
+	template<typename U>
+	slab_allocator(const slab_allocator<U, ChunkSource>&) {}
+
+	static T *allocate(std::size_t num);
+	static void deallocate(T *p, std::size_t num) noexcept;
+
+	static void allocate_batch(std::size_t num, T **result);
+	static void deallocate_batch(T **p, std::size_t num) noexcept;
+
+	//returns empty slabs to the system, answers the bytes released
+	static std::size_t trim() noexcept;
+	static std::size_t reserved_bytes() noexcept;
+};
+
+
+template<typename T, typename ChunkSource>
+std::mutex slab_allocator<T, ChunkSource>::pool_mutex;
+
+template<typename T, typename ChunkSource>
+typename slab_allocator<T, ChunkSource>::slab *slab_allocator<T, ChunkSource>::free_slabs = nullptr;
+
+template<typename T, typename ChunkSource>
+std::size_t slab_allocator<T, ChunkSource>::slab_num = 0;
+
+template<typename T, typename ChunkSource>
+typename slab_allocator<T, ChunkSource>::thread_cache *slab_allocator<T, ChunkSource>::caches = nullptr;
+
+template<typename T, typename ChunkSource>
+thread_local typename slab_allocator<T, ChunkSource>::cache_handle slab_allocator<T, ChunkSource>::local_cache;
+
+
+template<typename T, typename ChunkSource>
+T *slab_allocator<T, ChunkSource>::allocate(std::size_t num)
+{
+	T *result;
+	if (num != 1) {
+		result = static_cast<T*>(ChunkSource::allocate(num * sizeof(T), alignof(T)));
+	}
+	else {
+		result = alloc_node(local_cache.get());
+	}
+
+	alloc_trace::on_allocate(result, num * sizeof(T));
+	heap_profile::on_allocate<T>(result, num * sizeof(T));
+	return result;
+}
+
+
+template<typename T, typename ChunkSource>
+void slab_allocator<T, ChunkSource>::deallocate(T *p, std::size_t num) noexcept
+{
+	alloc_trace::on_deallocate(p, num * sizeof(T));
+	heap_profile::on_deallocate(p);
+	if (num != 1) {
+		ChunkSource::deallocate(p, num * sizeof(T), alignof(T));
+		return;
+	}
+
+	slab *s = slab_of(p);
+	if (s->owner == local_cache.cache) {
+		free_local(s->owner, s, p);
+		return;
+	}
+
+	free_remote(s->owner, p);
+}
+
+
+template<typename T, typename ChunkSource>
+void slab_allocator<T, ChunkSource>::allocate_batch(std::size_t num, T **result)
+{
+	thread_cache *cache = local_cache.get();
+	std::size_t i = 0;
+
+	try {
+		for (; i < num; ++i) {
+			result[i] = alloc_node(cache);
+			alloc_trace::on_allocate(result[i], sizeof(T));
+			heap_profile::on_allocate<T>(result[i], sizeof(T));
+		}
+	}
+	catch (...) {
+		deallocate_batch(result, i);
+		throw;
+	}
+}
+
+
+template<typename T, typename ChunkSource>
+void slab_allocator<T, ChunkSource>::deallocate_batch(T **p, std::size_t num) noexcept
+{
+	thread_cache *cache = local_cache.cache;
+	for (std::size_t i = 0; i < num; ++i)
+	{
+		alloc_trace::on_deallocate(p[i], sizeof(T));
+		heap_profile::on_deallocate(p[i]);
+		slab *s = slab_of(p[i]);
+		if (s->owner == cache) {
+			free_local(cache, s, p[i]);
+		}
+		else {
+			free_remote(s->owner, p[i]);
+		}
+	}
+}
+
+
+template<typename T, typename ChunkSource>
+T *slab_allocator<T, ChunkSource>::alloc_node(thread_cache *cache)
+{
+	slab *s = cache->current;
+	if (s == nullptr || s->free_num == 0) {
+		s = refill(cache);
+	}
+
+	std::size_t word = s->hint;
+	while (s->bitmap[word] == 0) {
+		++word;
+	}
+
+	std::size_t bit = bits::countr_zero(s->bitmap[word]);
+	s->bitmap[word] &= s->bitmap[word] - 1;
+	s->hint = word;
+	--s->free_num;
+
+	return reinterpret_cast<T*>(s->first + (word * 64 + bit) * NODE_SIZE);
+}
+
+
+template<typename T, typename ChunkSource>
+typename slab_allocator<T, ChunkSource>::slab *slab_allocator<T, ChunkSource>::refill(thread_cache *cache)
+{
+	//nodes freed by other threads may refill the current slab
+	collect_remote(cache);
+
+	slab *s = cache->current;
+	if (s != nullptr && s->free_num > 0) {
+		return s;
+	}
+
+	//a full current slab is tracked by nobody until one of its nodes is freed
+	s = cache->partial;
+	if (s != nullptr) {
+		unlink_partial(cache, s);
+	}
+	else {
+		s = slab_alloc(cache);
+	}
+
+	cache->current = s;
+	return s;
+}
+
+
+template<typename T, typename ChunkSource>
+typename slab_allocator<T, ChunkSource>::slab *slab_allocator<T, ChunkSource>::slab_alloc(thread_cache *cache)
+{
+	slab *result;
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		result = free_slabs;
+
+		if (result != nullptr) {
+			free_slabs = result->next;
+		}
+		else {
+			result = static_cast<slab*>(
+				ChunkSource::allocate(SLAB_SIZE, SLAB_SIZE));
+			++slab_num;
+		}
+	}
+
+	std::size_t color = cache->next_color;
+	cache->next_color = color + 1 == COLORS ? 0 : color + 1;
+
+	result->owner = cache;
+	result->prev = nullptr;
+	result->next = nullptr;
+	result->first = reinterpret_cast<char*>(result) + HEADER_SIZE + color * COLOR_STEP;
+	result->free_num = CAPACITY;
+	result->hint = 0;
+
+	for (std::size_t i = 0; i < BITMAP_WORDS; ++i)
+	{
+		std::size_t left = CAPACITY - i * 64;
+		result->bitmap[i] = left >= 64 ? ~std::uint64_t(0) :
+			(std::uint64_t(1) << left) - 1;
+	}
+
+	return result;
+}
+
+
+template<typename T, typename ChunkSource>
+void slab_allocator<T, ChunkSource>::slab_free(slab *s) noexcept
+{
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	s->owner = nullptr;
+	s->next = free_slabs;
+	free_slabs = s;
+}
+
+
+template<typename T, typename ChunkSource>
+void slab_allocator<T, ChunkSource>::free_local(thread_cache *cache, slab *s, void *p) noexcept
+{
+	std::size_t index = (static_cast<char*>(p) - s->first) / NODE_SIZE;
+	std::size_t word = index / 64;
+	s->bitmap[word] |= std::uint64_t(1) << (index % 64);
+	if (word < s->hint) {
+		s->hint = word;
+	}
+
+	if (s == cache->current) {
+		++s->free_num;
+	}
+	else if (s->free_num++ == 0) {
+		link_partial(cache, s);
+	}
+	else if (s->free_num == CAPACITY) {
+		unlink_partial(cache, s);
+		slab_free(s);
+	}
+}
+
+
+template<typename T, typename ChunkSource>
+void slab_allocator<T, ChunkSource>::free_remote(thread_cache *owner, void *p) noexcept
+{
+	node *block = static_cast<node*>(p);
+	node *old_head = owner->remote_free.load(std::memory_order_relaxed);
+
+	do {
+		block->next = old_head;
+	} while (!owner->remote_free.compare_exchange_weak(old_head, block,
+			 std::memory_order_release, std::memory_order_relaxed));
+}
+
+
+template<typename T, typename ChunkSource>
+void slab_allocator<T, ChunkSource>::collect_remote(thread_cache *cache) noexcept
+{
+	node *block = cache->remote_free.exchange(nullptr, std::memory_order_acquire);
+
+	while (block != nullptr)
+	{
+		node *next = block->next;
+		free_local(cache, slab_of(block), block);
+		block = next;
+	}
+}
+
+
+template<typename T, typename ChunkSource>
+void slab_allocator<T, ChunkSource>::release_empty(thread_cache *cache) noexcept
+{
+	collect_remote(cache);
+
+	slab *s = cache->current;
+	if (s != nullptr && s->free_num == CAPACITY) {
+		cache->current = nullptr;
+		slab_free(s);
+	}
+}
+
+
+template<typename T, typename ChunkSource>
+void slab_allocator<T, ChunkSource>::link_partial(thread_cache *cache, slab *s) noexcept
+{
+	s->prev = nullptr;
+	s->next = cache->partial;
+	if (cache->partial != nullptr) {
+		cache->partial->prev = s;
+	}
+	cache->partial = s;
+}
+
+
+template<typename T, typename ChunkSource>
+void slab_allocator<T, ChunkSource>::unlink_partial(thread_cache *cache, slab *s) noexcept
+{
+	if (s->prev != nullptr) {
+		s->prev->next = s->next;
+	}
+	else {
+		cache->partial = s->next;
+	}
+
+	if (s->next != nullptr) {
+		s->next->prev = s->prev;
+	}
+	s->prev = nullptr;
+	s->next = nullptr;
+}
+
+
+template<typename T, typename ChunkSource>
+typename slab_allocator<T, ChunkSource>::thread_cache *slab_allocator<T, ChunkSource>::cache_handle::get()
+{
+	if (cache != nullptr) {
+		return cache;
+	}
+
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	//adopt the cache, and the slabs, of a thread that has exited
+	for (thread_cache *iter = caches; iter != nullptr; iter = iter->next)
+	{
+		if (iter->retired) {
+			iter->retired = false;
+			cache = iter;
+			return cache;
+		}
+	}
+
+	cache = new thread_cache();
+	cache->next = caches;
+	caches = cache;
+	return cache;
+}
+
+
+template<typename T, typename ChunkSource>
+slab_allocator<T, ChunkSource>::cache_handle::~cache_handle() noexcept
+{
+	if (cache == nullptr) {
+		return;
+	}
+
+	release_empty(cache);
+
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	cache->retired = true;
+	cache = nullptr;
+}
+
+
+template<typename T, typename ChunkSource>
+std::size_t slab_allocator<T, ChunkSource>::trim() noexcept
+{
+	if (local_cache.cache != nullptr) {
+		release_empty(local_cache.cache);
+	}
+
+	thread_cache *head;
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		head = caches;
+	}
+
+	for (thread_cache *cache = head; cache != nullptr; cache = cache->next)
+	{
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			if (!cache->retired) {
+				continue;
+			}
+			cache->retired = false;
+		}
+
+		release_empty(cache);
+
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		cache->retired = true;
+	}
+
+	std::size_t released = 0;
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	while (free_slabs != nullptr)
+	{
+		slab *s = free_slabs;
+		free_slabs = s->next;
+		--slab_num;
+
+		ChunkSource::deallocate(s, SLAB_SIZE, SLAB_SIZE);
+		released += SLAB_SIZE;
+	}
+
+	return released;
+}
+
+
+template<typename T, typename ChunkSource>
+std::size_t slab_allocator<T, ChunkSource>::reserved_bytes() noexcept
+{
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	return slab_num * SLAB_SIZE;
+}
+
+
+template<typename T1, typename T2, typename ChunkSource>
+bool operator==(const slab_allocator<T1, ChunkSource>&,
+				const slab_allocator<T2, ChunkSource>&)
+{
+	return true;
+}
+
+template<typename T1, typename T2, typename ChunkSource>
+bool operator!=(const slab_allocator<T1, ChunkSource>&,
+				const slab_allocator<T2, ChunkSource>&)
+{
+	return false;
+}
@@ -0,0 +1,104 @@
+// trace_replay.cpp : replays an allocation trace against several allocators.
+//
+// Record a trace by building the program with CX_ALLOC_TRACE defined and
+// calling alloc_trace::start(path) / alloc_trace::stop(), then
+//   cl /std:c++17 /O2 /EHsc /I..\STL trace_replay.cpp
+//   g++ -std=c++17 -O2 -I../STL trace_replay.cpp -pthread
+//   trace_replay run.trace [--json]
+// The allocators share one process and see the heap left by the ones run
+// before them; name a single allocator to measure it alone:
+//   trace_replay run.trace free_list
+
+#include "alloc_trace.h"
+#include "malloc_allocator.h"
+#include "free_list_allocator.h"
+#include "memory_resource.h"
+#include "chunk_source.h"
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+
+static void print(const char *name, const replay_result& r, bool json, bool first)
+{
+	if (json) {
+		std::printf("%s{\"allocator\":\"%s\",\"events\":%zu,\"seconds\":%f,"
+					"\"ops_per_second\":%.0f,\"peak_live_bytes\":%zu,"
+					"\"peak_rss_bytes\":%zu,\"fragmentation\":%f}",
+					first ? "" : ",", name, r.events, r.seconds,
+					r.ops_per_second(), r.peak_live_bytes,
+					r.peak_rss_bytes, r.fragmentation());
+		return;
+	}
+
+	std::printf("%-16s %12.0f ops/s %12zu live %12zu rss %7.1f%% frag\n",
+				name, r.ops_per_second(), r.peak_live_bytes,
+				r.peak_rss_bytes, r.fragmentation() * 100);
+}
+
+
+template<typename Alloc>
+static void run(const char *name, const std::vector<trace_event>& events,
+				const char *only, bool json, bool& first, Alloc a = Alloc())
+{
+	if (only != nullptr && std::strcmp(only, name) != 0) {
+		return;
+	}
+
+	print(name, replay_trace(events, a), json, first);
+	first = false;
+}
+
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		std::fprintf(stderr, "usage: %s trace [allocator] [--json]\n"
+					 "allocators: malloc free_list free_list_thp pool\n", argv[0]);
+		return 2;
+	}
+
+	const char *only = nullptr;
+	bool json = false;
+	for (int i = 2; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--json") == 0) {
+			json = true;
+		}
+		else {
+			only = argv[i];
+		}
+	}
+
+	std::vector<trace_event> events;
+	try {
+		events = load_trace(argv[1]);
+	}
+	catch (const std::exception& e) {
+		std::fprintf(stderr, "%s: %s\n", argv[1], e.what());
+		return 1;
+	}
+
+	bool first = true;
+	if (json) {
+		std::printf("[");
+	}
+	else {
+		std::printf("%zu events\n", events.size());
+	}
+
+	run<malloc_allocator<char>>("malloc", events, only, json, first);
+	run<free_list_allocator<char>>("free_list", events, only, json, first);
+	run<free_list_allocator<char, geometric_size_classes<>, huge_page_chunk_source>>(
+		"free_list_thp", events, only, json, first);
+
+	pool_resource<> pool;
+	run<polymorphic_allocator<char>>("pool", events, only, json, first,
+									 polymorphic_allocator<char>(&pool));
+
+	if (json) {
+		std::printf("]\n");
+	}
+	return 0;
+}